@@ -1,119 +1,495 @@
-/* benchmark.cpp - Benchmark for FastIO vs std I/O.
+/* benchmark.cpp - Per-call latency benchmarks for FastIO vs std I/O.
    Copyright (C) 2025 deotermia
-   
+
    This file is part of FastIO, a fast I/O library for C++.
-   
+
    FastIO is free software: you can redistribute it and/or modify
    it under the terms of the GNU General Public License as published by
    the Free Software Foundation, either version 3 of the License, or
    (at your option) any later version.
-   
+
    FastIO is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
    GNU General Public License for more details.
-   
+
    You should have received a copy of the GNU General Public License
    along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
 
+/* Every case is timed in batches calibrated to about a millisecond,
+   repeated --runs times; the table shows the median, 99th percentile
+   and minimum of the per-run ns/op.  --filter keeps the cases whose
+   group or name contains a string, --json writes the results as JSON
+   (to stdout with '-') for comparing builds.  */
+
 #include "fastio/fastio.hpp"
+#include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+#if __has_include(<format>)
+#include <format>
+#endif
 
-void benchmark_fastio_format(int iterations) {
-    fastio::stopwatch sw;
-    volatile size_t dummy = 0;
-    
-    for (int i = 0; i < iterations; ++i) {
-        auto str = fastio::format("Iteration {}: value = {}", i, i * 2);
-        dummy += str.size();
-    }
-    
-    auto time = sw.elapsed();
-    fastio::println("FastIO::format: {} ms ({} iterations)", 
-                   time.count(), iterations);
+namespace {
+
+struct options {
+    int runs = 31;
+    std::string filter;
+    std::string json;
+};
+
+struct result {
+    std::string group;
+    std::string name;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    std::size_t batch;
+};
+
+/* Make VALUE look used so the work producing it is not optimized out.  */
+template<typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
 }
 
-void benchmark_fastio_println_format(int iterations) {
-    fastio::stopwatch sw;
-    
-    std::ofstream null_stream("/dev/null");
-    
-    for (int i = 0; i < iterations; ++i) {
-        fastio::fprintln(null_stream, "Iteration {}: value = {}", i, i * 2);
+class suite {
+public:
+    /* The table goes to stderr when the JSON goes to stdout.  */
+    explicit suite(const options& opts)
+        : m_opts(opts), m_table(opts.json == "-" ? std::cerr : std::cout) {}
+
+    template<typename Op>
+    void run(std::string_view group, std::string_view name, Op op) {
+        if (!m_opts.filter.empty()
+            && group.find(m_opts.filter) == std::string_view::npos
+            && name.find(m_opts.filter) == std::string_view::npos) {
+            return;
+        }
+        if (group != m_group) {
+            fastio::fprintln_fmt(m_table, "\n{:<34} {:>10} {:>10} {:>10}",
+                                 group, "median", "p99", "min");
+            m_group = group;
+        }
+
+        /* Double the batch until it takes long enough that the clock
+           resolution is noise; this doubles as the warm-up.  */
+        std::size_t batch = 1;
+        while (time_batch(op, batch) < target_ns && batch < (std::size_t(1) << 26)) {
+            batch *= 2;
+        }
+
+        std::vector<double> samples(m_opts.runs);
+        for (double& sample : samples) {
+            sample = time_batch(op, batch) / batch;
+        }
+        std::sort(samples.begin(), samples.end());
+        std::size_t p99 = (samples.size() * 99 + 99) / 100 - 1;
+
+        result r{std::string(group), std::string(name),
+                 samples[samples.size() / 2], samples[p99], samples.front(), batch};
+        fastio::fprintln_fmt(m_table, "  {:<32} {:>10.1f} {:>10.1f} {:>10.1f}",
+                             name, r.median_ns, r.p99_ns, r.min_ns);
+        m_results.push_back(std::move(r));
     }
-    
-    auto time = sw.elapsed();
-    fastio::println("FastIO::println with format: {} ms ({} iterations)", 
-                   time.count(), iterations);
+
+    template<typename Stream>
+    void write_json(Stream& os) const {
+        fastio::fprintln_fmt(os, "{{\"suite\": \"fastio\", \"runs\": {}, \"results\": [",
+                             m_opts.runs);
+        for (std::size_t i = 0; i < m_results.size(); ++i) {
+            const result& r = m_results[i];
+            fastio::fprintln_fmt(os, "  {{\"group\": \"{}\", \"name\": \"{}\", "
+                                 "\"median_ns\": {:.2f}, \"p99_ns\": {:.2f}, "
+                                 "\"min_ns\": {:.2f}, \"batch\": {}}}{}",
+                                 r.group, r.name, r.median_ns, r.p99_ns, r.min_ns,
+                                 r.batch, i + 1 < m_results.size() ? "," : "");
+        }
+        fastio::fprintln(os, "]}");
+    }
+
+private:
+    static constexpr double target_ns = 1e6;
+
+    template<typename Op>
+    static double time_batch(Op& op, std::size_t batch) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < batch; ++i) {
+            op(i);
+        }
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(stop - start).count();
+    }
+
+    const options& m_opts;
+    std::ostream& m_table;
+    std::string m_group;
+    std::vector<result> m_results;
+};
+
+constexpr std::size_t sample_mask = 1023;
+
+/* Values of every magnitude T can hold, so digit-count branches are
+   not predicted perfectly.  */
+template<typename T>
+std::vector<T> sample_values() {
+    std::vector<T> values(sample_mask + 1);
+    std::uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (T& value : values) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        int bits = 1 + (state >> 58) % (sizeof(T) * 8);
+        std::uint64_t raw = (state >> 7) & (bits >= 64 ? ~0ull : (1ull << bits) - 1);
+        value = static_cast<T>(raw);
+    }
+    return values;
+}
+
+template<typename T>
+void bench_integer(suite& s, const char* group) {
+    using wide = std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>;
+    const std::vector<T> values = sample_values<T>();
+    char buf[64];
+
+    s.run(group, "fastio::format_to", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{}", values[i & sample_mask]));
+    });
+    s.run(group, "fastio::write_int", [&](std::size_t i) {
+        keep(fastio::write_int(buf, values[i & sample_mask]));
+    });
+    s.run(group, "fastio::format", [&](std::size_t i) {
+        keep(fastio::format("{}", values[i & sample_mask]));
+    });
+    s.run(group, "std::to_chars", [&](std::size_t i) {
+        keep(std::to_chars(buf, buf + sizeof(buf), values[i & sample_mask]).ptr);
+    });
+#ifdef __cpp_lib_format
+    s.run(group, "std::format_to", [&](std::size_t i) {
+        keep(std::format_to(buf, "{}", values[i & sample_mask]));
+    });
+#endif
+    s.run(group, "snprintf", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), std::is_signed_v<T> ? "%lld" : "%llu",
+                           static_cast<wide>(values[i & sample_mask])));
+    });
+    s.run(group, "ostringstream", [&](std::size_t i) {
+        std::ostringstream os;
+        os << +values[i & sample_mask];
+        keep(os.str());
+    });
+}
+
+void bench_integers(suite& s) {
+    bench_integer<std::int8_t>(s, "int8");
+    bench_integer<std::int16_t>(s, "int16");
+    bench_integer<std::int32_t>(s, "int32");
+    bench_integer<std::int64_t>(s, "int64");
+    bench_integer<std::uint64_t>(s, "uint64");
 }
 
-void benchmark_fastio_print_plain(int iterations) {
-    fastio::stopwatch sw;
-    
-    std::ofstream null_stream("/dev/null");
-    
-    for (int i = 0; i < iterations; ++i) {
-        fastio::fprintln(null_stream, "Iteration ", i, ": value = ", i * 2);
+void bench_floats(suite& s) {
+    std::vector<double> values(sample_mask + 1);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = (static_cast<double>(i * 2654435761u % 1000003) - 500000.0) / 997.0;
     }
-    
-    auto time = sw.elapsed();
-    fastio::println("FastIO::println plain: {} ms ({} iterations)", 
-                   time.count(), iterations);
+    char buf[64];
+
+    s.run("double", "fastio::format_to {}", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{}", values[i & sample_mask]));
+    });
+    s.run("double", "fastio::format_to {:.3f}", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{:.3f}", values[i & sample_mask]));
+    });
+    s.run("double", "std::to_chars", [&](std::size_t i) {
+        keep(std::to_chars(buf, buf + sizeof(buf), values[i & sample_mask]).ptr);
+    });
+#ifdef __cpp_lib_format
+    s.run("double", "std::format_to {}", [&](std::size_t i) {
+        keep(std::format_to(buf, "{}", values[i & sample_mask]));
+    });
+    s.run("double", "std::format_to {:.3f}", [&](std::size_t i) {
+        keep(std::format_to(buf, "{:.3f}", values[i & sample_mask]));
+    });
+#endif
+    s.run("double", "snprintf %g", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), "%.17g", values[i & sample_mask]));
+    });
+    s.run("double", "snprintf %.3f", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), "%.3f", values[i & sample_mask]));
+    });
+    s.run("double", "ostringstream", [&](std::size_t i) {
+        std::ostringstream os;
+        os << values[i & sample_mask];
+        keep(os.str());
+    });
+}
+
+void bench_string(suite& s, const char* group, std::size_t length) {
+    const std::string str(length, 's');
+    char buf[1024];
+
+    s.run(group, "fastio::format_to", [&](std::size_t) {
+        keep(fastio::format_to(buf, "[{}]", str));
+    });
+    s.run(group, "fastio::format", [&](std::size_t) {
+        keep(fastio::format("[{}]", str));
+    });
+#ifdef __cpp_lib_format
+    s.run(group, "std::format_to", [&](std::size_t) {
+        keep(std::format_to(buf, "[{}]", str));
+    });
+#endif
+    s.run(group, "snprintf", [&](std::size_t) {
+        keep(std::snprintf(buf, sizeof(buf), "[%s]", str.c_str()));
+    });
+    s.run(group, "ostringstream", [&](std::size_t) {
+        std::ostringstream os;
+        os << '[' << str << ']';
+        keep(os.str());
+    });
+}
+
+void bench_strings(suite& s) {
+    bench_string(s, "string 8", 8);
+    bench_string(s, "string 64", 64);
+    bench_string(s, "string 512", 512);
+}
+
+void bench_arg_counts(suite& s) {
+    const std::vector<int> values = sample_values<int>();
+    char buf[512];
+    auto v = [&](std::size_t i, std::size_t k) { return values[(i + k) & sample_mask]; };
+
+    s.run("args", "fastio 1", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{}", v(i, 0)));
+    });
+    s.run("args", "snprintf 1", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), "%d", v(i, 0)));
+    });
+    s.run("args", "fastio 2", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{} {}", v(i, 0), v(i, 1)));
+    });
+    s.run("args", "snprintf 2", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), "%d %d", v(i, 0), v(i, 1)));
+    });
+    s.run("args", "fastio 4", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{} {} {} {}", v(i, 0), v(i, 1), v(i, 2), v(i, 3)));
+    });
+    s.run("args", "snprintf 4", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), "%d %d %d %d",
+                           v(i, 0), v(i, 1), v(i, 2), v(i, 3)));
+    });
+    s.run("args", "fastio 8", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{} {} {} {} {} {} {} {}",
+                               v(i, 0), v(i, 1), v(i, 2), v(i, 3),
+                               v(i, 4), v(i, 5), v(i, 6), v(i, 7)));
+    });
+    s.run("args", "snprintf 8", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf), "%d %d %d %d %d %d %d %d",
+                           v(i, 0), v(i, 1), v(i, 2), v(i, 3),
+                           v(i, 4), v(i, 5), v(i, 6), v(i, 7)));
+    });
+    s.run("args", "fastio 16", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "{} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {}",
+                               v(i, 0), v(i, 1), v(i, 2), v(i, 3),
+                               v(i, 4), v(i, 5), v(i, 6), v(i, 7),
+                               v(i, 8), v(i, 9), v(i, 10), v(i, 11),
+                               v(i, 12), v(i, 13), v(i, 14), v(i, 15)));
+    });
+    s.run("args", "snprintf 16", [&](std::size_t i) {
+        keep(std::snprintf(buf, sizeof(buf),
+                           "%d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d",
+                           v(i, 0), v(i, 1), v(i, 2), v(i, 3),
+                           v(i, 4), v(i, 5), v(i, 6), v(i, 7),
+                           v(i, 8), v(i, 9), v(i, 10), v(i, 11),
+                           v(i, 12), v(i, 13), v(i, 14), v(i, 15)));
+    });
+}
+
+/* One log-style line through each way of producing it; the sinks
+   write to /dev/null so only the library side is measured.  */
+void bench_line(suite& s) {
+    const std::string symbol = "EURUSD";
+    char buf[256];
+    int null_fd = open("/dev/null", O_WRONLY);
+    fastio::fd_writer out(null_fd);
+    std::ofstream file("/dev/null");
+    std::FILE* stdio = std::fopen("/dev/null", "w");
+
+    s.run("line", "fastio::format", [&](std::size_t i) {
+        keep(fastio::format("order {} {} qty {} px {:.2f}", i, symbol, 100, 1.0825));
+    });
+    s.run("line", "fastio::format compiled", [&](std::size_t i) {
+        keep(fastio::format(fastio::compiled<"order {} {} qty {} px {:.2f}">,
+                            i, symbol, 100, 1.0825));
+    });
+    s.run("line", "fastio::format_to", [&](std::size_t i) {
+        keep(fastio::format_to(buf, "order {} {} qty {} px {:.2f}", i, symbol, 100, 1.0825));
+    });
+    s.run("line", "fastio::fprintln_fmt fd_writer", [&](std::size_t i) {
+        fastio::fprintln_fmt(out, "order {} {} qty {} px {:.2f}", i, symbol, 100, 1.0825);
+    });
+    s.run("line", "fastio::fprintln_fmt ofstream", [&](std::size_t i) {
+        fastio::fprintln_fmt(file, "order {} {} qty {} px {:.2f}", i, symbol, 100, 1.0825);
+    });
+#ifdef __cpp_lib_format
+    s.run("line", "std::format", [&](std::size_t i) {
+        keep(std::format("order {} {} qty {} px {:.2f}", i, symbol, 100, 1.0825));
+    });
+#endif
+    s.run("line", "ofstream <<", [&](std::size_t i) {
+        file << "order " << i << ' ' << symbol << " qty " << 100
+             << " px " << std::fixed << std::setprecision(2) << 1.0825 << '\n';
+    });
+    s.run("line", "snprintf + fwrite", [&](std::size_t i) {
+        int n = std::snprintf(buf, sizeof(buf), "order %zu %s qty %d px %.2f\n",
+                              i, symbol.c_str(), 100, 1.0825);
+        std::fwrite(buf, 1, n, stdio);
+    });
+
+    out.flush();
+    std::fclose(stdio);
+    close(null_fd);
 }
 
-void benchmark_cout(int iterations) {
-    fastio::stopwatch sw;
-    
-    std::ofstream null_stream("/dev/null");
-    auto old_cout = std::cout.rdbuf(null_stream.rdbuf());
-    
-    for (int i = 0; i < iterations; ++i) {
-        std::cout << "Iteration " << i << ": value = " << i * 2 << "\n";
+void bench_parsing(suite& s) {
+    std::vector<std::string> ints;
+    for (int value : sample_values<int>()) {
+        ints.push_back(std::to_string(value));
     }
-    
-    std::cout.rdbuf(old_cout);
-    auto time = sw.elapsed();
-    fastio::println("std::cout: {} ms ({} iterations)", 
-                   time.count(), iterations);
+    std::vector<std::string> doubles;
+    for (std::size_t i = 0; i <= sample_mask; ++i) {
+        doubles.push_back(fastio::format("{:.6f}", (static_cast<double>(i) * 7919.0 - 4e6) / 113.0));
+    }
+
+    s.run("parse int", "fastio::try_parse_int", [&](std::size_t i) {
+        keep(*fastio::try_parse_int<int>(ints[i & sample_mask]));
+    });
+    s.run("parse int", "fastio::string_reader", [&](std::size_t i) {
+        fastio::string_reader in(ints[i & sample_mask]);
+        int value = 0;
+        in.read(value);
+        keep(value);
+    });
+    s.run("parse int", "std::from_chars", [&](std::size_t i) {
+        const std::string& str = ints[i & sample_mask];
+        int value = 0;
+        std::from_chars(str.data(), str.data() + str.size(), value);
+        keep(value);
+    });
+    s.run("parse int", "strtol", [&](std::size_t i) {
+        keep(std::strtol(ints[i & sample_mask].c_str(), nullptr, 10));
+    });
+    s.run("parse int", "istringstream", [&](std::size_t i) {
+        std::istringstream in(ints[i & sample_mask]);
+        int value = 0;
+        in >> value;
+        keep(value);
+    });
+
+    s.run("parse double", "fastio::string_reader", [&](std::size_t i) {
+        fastio::string_reader in(doubles[i & sample_mask]);
+        double value = 0;
+        in.read(value);
+        keep(value);
+    });
+    s.run("parse double", "std::from_chars", [&](std::size_t i) {
+        const std::string& str = doubles[i & sample_mask];
+        double value = 0;
+        std::from_chars(str.data(), str.data() + str.size(), value);
+        keep(value);
+    });
+    s.run("parse double", "strtod", [&](std::size_t i) {
+        keep(std::strtod(doubles[i & sample_mask].c_str(), nullptr));
+    });
+    s.run("parse double", "istringstream", [&](std::size_t i) {
+        std::istringstream in(doubles[i & sample_mask]);
+        double value = 0;
+        in >> value;
+        keep(value);
+    });
 }
 
-void benchmark_sprintf(int iterations) {
-    fastio::stopwatch sw;
-    volatile size_t dummy = 0;
-    char buffer[256];
-    
-    for (int i = 0; i < iterations; ++i) {
-        int len = snprintf(buffer, sizeof(buffer), 
-                          "Iteration %d: value = %d", i, i * 2);
-        dummy += len;
+/* Cost of taking a timestamp and of recording it, which bounds how
+   finely a hot path can be instrumented.  */
+void bench_timing(suite& s) {
+    fastio::latency_histogram histogram;
+    fastio::latency_recorder recorder;
+
+    s.run("timing", "steady_clock::now", [&](std::size_t) {
+        keep(std::chrono::steady_clock::now());
+    });
+    s.run("timing", "fastio::cycle_clock::ticks", [&](std::size_t) {
+        keep(fastio::cycle_clock::ticks());
+    });
+    s.run("timing", "latency_histogram::record", [&](std::size_t i) {
+        histogram.record(i & 0xffff);
+    });
+    s.run("timing", "latency_recorder::record", [&](std::size_t i) {
+        recorder.record(i & 0xffff);
+    });
+    s.run("timing", "latency_recorder::time", [&](std::size_t) {
+        auto timer = recorder.time();
+    });
+}
+
+bool parse_options(int argc, char** argv, options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (i + 1 < argc && arg == "--runs") {
+            opts.runs = std::max(1, std::atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--filter") {
+            opts.filter = argv[++i];
+        } else if (i + 1 < argc && arg == "--json") {
+            opts.json = argv[++i];
+        } else {
+            fastio::fprintln_fmt(std::cerr, "usage: {} [--runs N] [--filter STR] [--json FILE|-]",
+                                 argv[0]);
+            return false;
+        }
     }
-    
-    auto time = sw.elapsed();
-    fastio::println("snprintf: {} ms ({} iterations)", 
-                   time.count(), iterations);
+    return true;
 }
 
-int main() {
-    const int warmup = 1000;
-    const int iterations = 100000;
-    
-    fastio::println("=== FastIO Benchmark ===");
-    fastio::println("Iterations: {}", iterations);
-    fastio::println("");
-    
-    for (int i = 0; i < warmup; ++i) {
-        auto warm = fastio::format("warmup {}", i);
+} // namespace
+
+int main(int argc, char** argv) {
+    options opts;
+    if (!parse_options(argc, argv, opts)) {
+        return 2;
     }
-    
-    benchmark_fastio_format(iterations);
-    benchmark_fastio_println_format(iterations);
-    benchmark_fastio_print_plain(iterations);
-    benchmark_cout(iterations);
-    benchmark_sprintf(iterations);
-    
-    fastio::println("");
-    fastio::println("Benchmark completed!");
-    
+
+    std::ostream& table = opts.json == "-" ? std::cerr : std::cout;
+    fastio::fprintln_fmt(table, "=== FastIO Benchmark === (ns/op over {} runs)", opts.runs);
+
+    suite s(opts);
+    bench_integers(s);
+    bench_floats(s);
+    bench_strings(s);
+    bench_arg_counts(s);
+    bench_line(s);
+    bench_parsing(s);
+    bench_timing(s);
+
+    if (opts.json == "-") {
+        s.write_json(std::cout);
+    } else if (!opts.json.empty()) {
+        std::ofstream json(opts.json);
+        s.write_json(json);
+        fastio::fprintln_fmt(table, "\nResults written to {}", opts.json);
+    }
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,662 @@
+/* throughput.cpp - Throughput benchmarks for FastIO sinks and readers.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "fastio/fastio.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+static size_t g_allocations = 0;
+static size_t g_allocated_bytes = 0;
+
+/* Every allocation form is replaced, so each new is paired with the
+   matching delete and all of them are counted.  */
+static void* counted_alloc(size_t size, size_t align = 0) {
+    ++g_allocations;
+    g_allocated_bytes += size;
+    void* ptr = align > alignof(std::max_align_t)
+                    ? std::aligned_alloc(align, (size + align - 1) / align * align)
+                    : std::malloc(size ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size) {
+    return counted_alloc(size);
+}
+
+void* operator new[](size_t size) {
+    return counted_alloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    return counted_alloc(size, static_cast<size_t>(align));
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+    return counted_alloc(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+template<typename Format>
+void benchmark_sizing(const char* name, int iterations, Format format) {
+    std::string symbol = "EURUSD.spot.venue-primary.book-level-2";
+    size_t allocations = g_allocations;
+    size_t bytes = g_allocated_bytes;
+    fastio::stopwatch sw;
+    volatile size_t dummy = 0;
+    
+    for (int i = 0; i < iterations; ++i) {
+        auto str = format(symbol, i, i * 0.25);
+        dummy = dummy + str.size();
+    }
+    
+    auto time = sw.elapsed();
+    fastio::println_fmt("{}: {} ms, {} allocs/op, {} bytes/op", name,
+                        time.count(),
+                        (g_allocations - allocations) / iterations,
+                        (g_allocated_bytes - bytes) / iterations);
+}
+
+void benchmark_fastio_sizing(int iterations) {
+    benchmark_sizing("FastIO::format (estimate)", iterations,
+                     [](const std::string& sym, int qty, double px) {
+                         return fastio::format("order {} qty={} px={}",
+                                               sym, qty, px);
+                     });
+    benchmark_sizing("FastIO::format_exact", iterations,
+                     [](const std::string& sym, int qty, double px) {
+                         return fastio::format_exact("order {} qty={} px={}",
+                                                     sym, qty, px);
+                     });
+}
+
+void benchmark_gather_writer(int records, std::size_t payload_size) {
+    int fd = open("/dev/null", O_WRONLY);
+    std::string payload(payload_size, 'x');
+    {
+        fastio::fd_writer out(fd, fastio::flush_policy::on_size);
+        fastio::stopwatch sw;
+        for (int i = 0; i < records; ++i) {
+            fastio::fprintln(out, "record ", i, ' ', payload);
+        }
+        out.flush();
+        auto time = sw.elapsed();
+        fastio::println_fmt("fd_writer (copy): {} ms ({} records x {} bytes)",
+                            time.count(), records, payload_size);
+    }
+    {
+        fastio::gather_writer out(fd);
+        std::string_view view(payload);
+        fastio::stopwatch sw;
+        for (int i = 0; i < records; ++i) {
+            fastio::fprintln(out, "record ", i, ' ', view);
+        }
+        out.flush();
+        auto time = sw.elapsed();
+        fastio::println_fmt("gather_writer (writev): {} ms ({} records x {} bytes)",
+                            time.count(), records, payload_size);
+    }
+    close(fd);
+}
+
+template<typename Writer>
+void benchmark_file_sink(const char* name, Writer& out, std::size_t total) {
+    std::string block(256, '.');
+    fastio::stopwatch sw;
+    std::size_t written = 0;
+    for (int i = 0; written < total; ++i) {
+        fastio::fprintln_fmt(out, "record {:>9} value {:12.3f} {}", i, i * 0.001, block);
+        written += 7 + 9 + 7 + 12 + 1 + block.size() + 1;
+    }
+    out.flush();
+    double seconds = sw.elapsed<std::chrono::microseconds>().count() / 1e6;
+    fastio::println_fmt("{}: {:.2f} GB/s ({} MB)", name, written / seconds / 1e9,
+                        written >> 20);
+}
+
+void benchmark_async_file(std::size_t total) {
+    const char* path = "/dev/shm/fastio_bench_out";
+    {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        fastio::fd_writer out(fd, fastio::flush_policy::on_size, 1 << 20);
+        benchmark_file_sink("fd_writer (blocking write)", out, total);
+        close(fd);
+    }
+    {
+        fastio::async_file_writer out(path);
+        benchmark_file_sink(out.backend() == fastio::write_backend::io_uring
+                            ? "async_file_writer (io_uring)"
+                            : "async_file_writer (thread)", out, total);
+    }
+    {
+        fastio::async_file_writer out(path, fastio::async_file_writer::default_capacity,
+                                      fastio::write_backend::thread);
+        benchmark_file_sink("async_file_writer (thread)", out, total);
+    }
+    unlink(path);
+}
+
+struct trade_stream {
+    int id;
+    int quantity;
+    double price;
+};
+
+std::ostream& operator<<(std::ostream& os, const trade_stream& t) {
+    return os << "trade#" << t.id << ' ' << t.quantity << " @ " << t.price;
+}
+
+struct trade {
+    int id;
+    int quantity;
+    double price;
+};
+
+template<>
+struct fastio::formatter<trade> {
+    void format(const trade& t, fastio::format_context& ctx) const {
+        fastio::format_to(ctx, fastio::compiled<"trade#{} {} @ {}">, t.id, t.quantity, t.price);
+    }
+    
+    std::size_t size_hint(const trade&) const { return 48; }
+};
+
+void benchmark_ranges(int count) {
+    std::vector<int> ints(count);
+    std::vector<double> reals(count);
+    for (int i = 0; i < count; ++i) {
+        ints[i] = static_cast<int>(i * 7919LL % 2000000) - 1000000;
+        reals[i] = i * 0.37;
+    }
+    std::size_t total = 0;
+    {
+        fastio::stopwatch sw;
+        std::string out = "[";
+        for (std::size_t i = 0; i < ints.size(); ++i) {
+            if (i) out += ", ";
+            out += fastio::format("{}", ints[i]);
+        }
+        out += "]";
+        total += out.size();
+        auto time = sw.elapsed();
+        fastio::println_fmt("vector<int> per-element format: {} ms", time.count());
+    }
+    {
+        fastio::stopwatch sw;
+        std::ostringstream oss;
+        oss << '[';
+        for (std::size_t i = 0; i < ints.size(); ++i) {
+            if (i) oss << ", ";
+            oss << ints[i];
+        }
+        oss << ']';
+        total += oss.str().size();
+        auto time = sw.elapsed();
+        fastio::println_fmt("vector<int> ostringstream: {} ms", time.count());
+    }
+    {
+        fastio::stopwatch sw;
+        std::string out = fastio::format("{}", ints);
+        total += out.size();
+        auto time = sw.elapsed();
+        fastio::println_fmt("vector<int> format(\"{{}}\", v): {} ms ({} elements)",
+                            time.count(), count);
+    }
+    {
+        fastio::stopwatch sw;
+        std::string out = fastio::format("{}", reals);
+        total += out.size();
+        auto time = sw.elapsed();
+        fastio::println_fmt("vector<double> format(\"{{}}\", v): {} ms ({} elements)",
+                            time.count(), count);
+    }
+    volatile std::size_t sink = total;
+    (void)sink;
+}
+
+void benchmark_user_types(int iterations) {
+    std::size_t total = 0;
+    {
+        fastio::stopwatch sw;
+        for (int i = 0; i < iterations; ++i) {
+            total += fastio::format("{}", trade_stream{i, i % 500, i * 0.25}).size();
+        }
+        auto time = sw.elapsed<std::chrono::microseconds>();
+        fastio::println_fmt("user type via operator<<: {} us", time.count());
+    }
+    {
+        fastio::stopwatch sw;
+        for (int i = 0; i < iterations; ++i) {
+            total += fastio::format("{}", trade{i, i % 500, i * 0.25}).size();
+        }
+        auto time = sw.elapsed<std::chrono::microseconds>();
+        fastio::println_fmt("user type via formatter<T>: {} us", time.count());
+    }
+    volatile std::size_t sink = total;
+    (void)sink;
+}
+
+void benchmark_format_fixed(int iterations) {
+    std::size_t total = 0;
+    {
+        fastio::stopwatch sw;
+        for (int i = 0; i < iterations; ++i) {
+            auto s = fastio::format("order {} filled {} @ {:.2f}", i, i % 100, i * 0.01);
+            total += s.size();
+        }
+        auto time = sw.elapsed<std::chrono::microseconds>();
+        fastio::println_fmt("format -> std::string: {} us", time.count());
+    }
+    {
+        fastio::stopwatch sw;
+        for (int i = 0; i < iterations; ++i) {
+            auto s = fastio::format_fixed<64>("order {} filled {} @ {:.2f}", i, i % 100, i * 0.01);
+            total += s.size();
+        }
+        auto time = sw.elapsed<std::chrono::microseconds>();
+        fastio::println_fmt("format_fixed<64>: {} us", time.count());
+    }
+    volatile std::size_t sink = total;
+    (void)sink;
+}
+
+void benchmark_arena_format(int requests) {
+    constexpr int fields = 50;
+    std::size_t total = 0;
+    {
+        fastio::stopwatch sw;
+        for (int r = 0; r < requests; ++r) {
+            std::vector<std::string> out;
+            out.reserve(fields);
+            for (int i = 0; i < fields; ++i) {
+                out.push_back(fastio::format("field{}={} ({:.2f})", i, r, r * 0.5));
+            }
+            total += out.back().size();
+        }
+        auto time = sw.elapsed();
+        fastio::println_fmt("format -> std::string: {} ms ({} requests x {} fields)",
+                            time.count(), requests, fields);
+    }
+    {
+        fastio::format_arena arena;
+        fastio::stopwatch sw;
+        for (int r = 0; r < requests; ++r) {
+            std::string_view out[fields];
+            for (int i = 0; i < fields; ++i) {
+                out[i] = fastio::format(arena, "field{}={} ({:.2f})", i, r, r * 0.5);
+            }
+            total += out[fields - 1].size();
+            arena.reset();
+        }
+        auto time = sw.elapsed();
+        fastio::println_fmt("format -> format_arena: {} ms ({} requests x {} fields)",
+                            time.count(), requests, fields);
+    }
+    volatile std::size_t sink = total;
+    (void)sink;
+}
+
+void benchmark_async_logger(int threads, int per_thread) {
+    int fd = open("/dev/null", O_WRONLY);
+    {
+        fastio::fd_writer out(fd, fastio::flush_policy::on_size);
+        std::mutex mutex;
+        fastio::stopwatch sw;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fastio::fprintln_fmt(out, "worker {} request {} took {} us", t, i, i % 977);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto time = sw.elapsed();
+        fastio::println_fmt("mutex + fprintln_fmt: {} ms ({} threads x {})",
+                            time.count(), threads, per_thread);
+    }
+    {
+        fastio::async_logger logger(fd, fastio::overflow_policy::block, 1 << 16);
+        fastio::stopwatch sw;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    logger.log("worker {} request {} took {} us", t, i, i % 977);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto producers = sw.elapsed();
+        logger.flush();
+        auto time = sw.elapsed();
+        fastio::println_fmt("async_logger: {} ms producers, {} ms written ({} threads x {})",
+                            producers.count(), time.count(), threads, per_thread);
+    }
+    {
+        fastio::stopwatch sw;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                fastio::fd_writer out(fd, fastio::flush_policy::whole_lines, PIPE_BUF);
+                for (int i = 0; i < per_thread; ++i) {
+                    fastio::fprintln_fmt(out, "worker {} request {} took {} us", t, i, i % 977);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto time = sw.elapsed();
+        fastio::println_fmt("per-thread whole_lines writers: {} ms ({} threads x {})",
+                            time.count(), threads, per_thread);
+    }
+    close(fd);
+}
+
+std::string make_int_file(int count) {
+    char path[] = "/tmp/fastio_bench_XXXXXX";
+    int fd = mkstemp(path);
+    {
+        fastio::fd_writer out(fd, fastio::flush_policy::on_size);
+        for (int i = 0; i < count; ++i) {
+            fastio::fprint(out, static_cast<int>(i * 7919LL % 2000000) - 1000000,
+                           i % 10 == 9 ? '\n' : ' ');
+        }
+    }
+    close(fd);
+    return path;
+}
+
+void benchmark_fd_reader_ints(const std::string& path, int count) {
+    int fd = open(path.c_str(), O_RDONLY);
+    fastio::stopwatch sw;
+    fastio::fd_reader reader(fd);
+    long long sum = 0;
+    int value;
+    
+    for (int i = 0; i < count && reader.read(value); ++i) {
+        sum += value;
+    }
+    
+    auto time = sw.elapsed();
+    close(fd);
+    fastio::println_fmt("fd_reader ints: {} ms ({} values, sum {})",
+                       time.count(), count, sum);
+}
+
+void benchmark_mapped_ints(const std::string& path, int count) {
+    fastio::stopwatch sw;
+    fastio::mapped_file file(path);
+    long long sum = 0;
+    int value;
+    
+    for (int i = 0; i < count && file.read(value); ++i) {
+        sum += value;
+    }
+    
+    auto time = sw.elapsed();
+    fastio::println_fmt("mapped_file ints: {} ms ({} values, sum {})",
+                       time.count(), count, sum);
+}
+
+void benchmark_cin_ints(const std::string& path, int count) {
+    std::ifstream file(path);
+    auto old_cin = std::cin.rdbuf(file.rdbuf());
+    fastio::stopwatch sw;
+    long long sum = 0;
+    int value;
+    
+    for (int i = 0; i < count && std::cin >> value; ++i) {
+        sum += value;
+    }
+    
+    auto time = sw.elapsed();
+    std::cin.rdbuf(old_cin);
+    fastio::println_fmt("std::cin ints: {} ms ({} values, sum {})",
+                       time.count(), count, sum);
+}
+
+void benchmark_parse_ints(int count) {
+    std::string csv;
+    char buffer[32];
+    for (int i = 0; i < count; ++i) {
+        csv.append(buffer, fastio::format_to(buffer, "{}", (i * 7919LL) % 2000000000 - 1000000000));
+        csv += i % 10 == 9 ? '\n' : ',';
+    }
+    std::vector<int> values(count);
+    
+    fastio::stopwatch sw;
+    const char* p = csv.data();
+    const char* last = p + csv.size();
+    for (int i = 0; i < count; ++i) {
+        auto [ptr, ec] = std::from_chars(p, last, values[i]);
+        p = ptr + 1;
+    }
+    auto time = sw.elapsed<std::chrono::microseconds>();
+    fastio::println_fmt("from_chars CSV ints: {} us ({} values)", time.count(), count);
+    
+    sw.reset();
+    auto result = fastio::parse_ints(csv, std::span<int>(values));
+    time = sw.elapsed<std::chrono::microseconds>();
+    fastio::println_fmt("parse_ints CSV ints: {} us ({} values)", time.count(), result.count);
+}
+
+void benchmark_input_ints(int count) {
+    std::string path = make_int_file(count);
+    benchmark_fd_reader_ints(path, count);
+    benchmark_mapped_ints(path, count);
+    benchmark_cin_ints(path, count);
+    unlink(path.c_str());
+}
+
+std::string make_log_data(size_t bytes) {
+    std::string data;
+    data.reserve(bytes + 128);
+    char line[128];
+    for (int i = 0; data.size() < bytes; ++i) {
+        char* end = fastio::format_to(line,
+            "2025-03-{:02}T12:{:02}:{:02} {} worker-{} request id={} latency_us={}\n",
+            i % 28 + 1, i % 60, i / 60 % 60, i % 5 ? "INFO" : "WARN", i % 32,
+            i * 7919, i % 9973);
+        data.append(line, end);
+    }
+    return data;
+}
+
+template<typename FindNewline>
+void benchmark_scan_lines(const char* name, const std::string& data, int passes,
+                          FindNewline find_newline) {
+    fastio::stopwatch sw;
+    size_t lines = 0;
+    
+    for (int pass = 0; pass < passes; ++pass) {
+        const char* first = data.data();
+        const char* last = first + data.size();
+        while ((first = find_newline(first, last)) != last) {
+            ++first;
+            ++lines;
+        }
+    }
+    
+    auto time = sw.elapsed();
+    double gb = double(data.size()) * passes / 1e9;
+    fastio::println_fmt("{}: {} ms, {:.2f} GB/s ({} lines)", name, time.count(),
+                        gb / (time.count() / 1e3), lines);
+}
+
+template<typename Reader>
+void benchmark_scan_tokens(const char* name, const std::string& data, int passes) {
+    fastio::stopwatch sw;
+    size_t tokens = 0;
+    
+    for (int pass = 0; pass < passes; ++pass) {
+        Reader reader(data);
+        while (!reader.token().empty()) {
+            ++tokens;
+        }
+    }
+    
+    auto time = sw.elapsed();
+    double gb = double(data.size()) * passes / 1e9;
+    fastio::println_fmt("{}: {} ms, {:.2f} GB/s ({} tokens)", name, time.count(),
+                        gb / (time.count() / 1e3), tokens);
+}
+
+struct scalar_token_reader {
+    explicit scalar_token_reader(std::string_view text)
+        : pos(text.data()), end(text.data() + text.size()) {}
+    
+    std::string_view token() {
+        const char* first = fastio::internal::scalar::skip_space(pos, end);
+        pos = fastio::internal::scalar::find_space(first, end);
+        return std::string_view(first, pos - first);
+    }
+    
+    const char* pos;
+    const char* end;
+};
+
+void benchmark_scanning() {
+    namespace in = fastio::internal;
+    const int passes = 16;
+    std::string data = make_log_data(64 << 20);
+    
+    benchmark_scan_lines("lines (scalar)", data, passes,
+                         [](const char* f, const char* l) {
+                             return in::scalar::find_char(f, l, '\n');
+                         });
+    benchmark_scan_lines("lines (simd)", data, passes,
+                         [](const char* f, const char* l) {
+                             return in::find_newline(f, l);
+                         });
+    benchmark_scan_tokens<scalar_token_reader>("tokens (scalar)", data, passes);
+    benchmark_scan_tokens<fastio::string_reader>("tokens (simd)", data, passes);
+}
+
+template<typename Encode>
+void benchmark_hex(const char* name, const std::vector<std::byte>& data, int passes,
+                   Encode encode) {
+    std::string out(2 * data.size(), '\0');
+    fastio::stopwatch sw;
+    
+    for (int pass = 0; pass < passes; ++pass) {
+        encode(out.data(), data);
+    }
+    
+    auto time = sw.elapsed();
+    double gb = double(data.size()) * passes / 1e9;
+    fastio::println_fmt("{}: {} ms, {:.2f} GB/s in ({})", name, time.count(),
+                        gb / (time.count() / 1e3), out.substr(0, 8));
+}
+
+void benchmark_hex_dump() {
+    namespace in = fastio::internal;
+    const int passes = 64;
+    std::vector<std::byte> data(std::size_t(4) << 20);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = std::byte(i * 131 + 7);
+    }
+    
+    benchmark_hex("hex (snprintf)", data, 2, [](char* out, const auto& bytes) {
+        for (std::byte b : bytes) {
+            std::snprintf(out, 3, "%02x", unsigned(b));
+            out += 2;
+        }
+    });
+    benchmark_hex("hex (scalar)", data, passes, [](char* out, const auto& bytes) {
+        in::scalar::encode_hex(out, bytes.data(), bytes.size(), in::hex_digits_lower);
+    });
+    benchmark_hex("hex (hex_dump)", data, passes, [](char* out, const auto& bytes) {
+        fastio::format_to(out, "{}", fastio::hex_dump(bytes));
+    });
+}
+
+int main() {
+    const int iterations = 100000;
+    
+    fastio::println("=== FastIO Throughput ===");
+    fastio::println("(per-call latencies: see the benchmark target)");
+    fastio::println("");
+    
+    benchmark_fastio_sizing(iterations);
+    benchmark_arena_format(100000);
+    benchmark_format_fixed(1000000);
+    benchmark_user_types(1000000);
+    benchmark_ranges(1000000);
+    benchmark_async_logger(4, 250000);
+    benchmark_gather_writer(1000000, 4096);
+    benchmark_async_file(std::size_t(1) << 30);
+    benchmark_input_ints(10000000);
+    benchmark_parse_ints(10000000);
+    benchmark_scanning();
+    benchmark_hex_dump();
+    
+    fastio::println("");
+    fastio::println("Benchmark completed!");
+    
+    return 0;
+}
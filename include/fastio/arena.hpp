@@ -0,0 +1,257 @@
+/* arena.hpp - Arena-backed formatting for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_ARENA_HPP
+#define FASTIO_ARENA_HPP
+
+#include "format.hpp"
+#include "compile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fastio {
+
+/* Monotonic bump allocator for formatted text.  Each string is
+   formatted in place at the end of the current block, moving to a
+   fresh block only when it outgrows the space left, so a burst of
+   format calls makes no heap allocation once the blocks exist.
+   reset () releases every string at once and keeps the blocks.  */
+class format_arena
+{
+public:
+  static constexpr std::size_t default_block_size = 16 * 1024;
+
+  /* Allocate blocks of at least BLOCK_SIZE bytes from UPSTREAM.  */
+  explicit format_arena (std::size_t block_size = default_block_size,
+                         std::pmr::memory_resource* upstream
+                           = std::pmr::get_default_resource ())
+    : m_block_size (block_size ? block_size : 1),
+      m_upstream (upstream)
+  {
+  }
+
+  /* Use the caller's BUFFER first; only overflow goes to UPSTREAM.  */
+  explicit format_arena (std::span<char> buffer,
+                         std::pmr::memory_resource* upstream
+                           = std::pmr::get_default_resource ())
+    : format_arena (std::max<std::size_t> (buffer.size (), default_block_size),
+                    upstream)
+  {
+    if (!buffer.empty ())
+      {
+        m_blocks.push_back ({ buffer.data (), buffer.size (), false });
+      }
+  }
+
+  format_arena (const format_arena&) = delete;
+  format_arena& operator= (const format_arena&) = delete;
+
+  ~format_arena ()
+  {
+    for (const block& b : m_blocks)
+      {
+        if (b.owned)
+          {
+            m_upstream->deallocate (b.data, b.size, 1);
+          }
+      }
+  }
+
+  /* Invalidate every string handed out and start over.  */
+  void reset () noexcept
+  {
+    m_current = 0;
+    m_used = 0;
+  }
+
+  /* Bytes handed out so far, counting blocks left behind as full.  */
+  std::size_t used () const noexcept
+  {
+    std::size_t total = m_used;
+    for (std::size_t i = 0; i < m_current && i < m_blocks.size (); ++i)
+      {
+        total += m_blocks[i].size;
+      }
+    return total;
+  }
+
+private:
+  friend class arena_context;
+
+  struct block
+  {
+    char* data;
+    std::size_t size;
+    bool owned;
+  };
+
+  char* free_data () const noexcept
+  {
+    return m_blocks.empty () ? nullptr : m_blocks[m_current].data + m_used;
+  }
+
+  std::size_t free_size () const noexcept
+  {
+    return m_blocks.empty () ? 0 : m_blocks[m_current].size - m_used;
+  }
+
+  /* Move on to a block with at least SIZE bytes, reusing blocks kept
+     by an earlier reset () and allocating one when none is left.  */
+  void next_block (std::size_t size)
+  {
+    std::size_t i = m_blocks.empty () ? 0 : m_current + 1;
+    for (; i < m_blocks.size (); ++i)
+      {
+        if (m_blocks[i].size >= size)
+          {
+            m_current = i;
+            m_used = 0;
+            return;
+          }
+      }
+    std::size_t bytes = std::max (m_block_size, size);
+    m_blocks.push_back ({ static_cast<char*> (m_upstream->allocate (bytes, 1)),
+                          bytes, true });
+    m_current = m_blocks.size () - 1;
+    m_used = 0;
+  }
+
+  std::vector<block> m_blocks;
+  std::size_t m_current = 0;
+  std::size_t m_used = 0;
+  std::size_t m_block_size;
+  std::pmr::memory_resource* m_upstream;
+};
+
+/* Format context writing into the free space of a format_arena.
+   finish () claims the output and returns a view of it.  */
+class arena_context : public format_context
+{
+public:
+  /* Start a string in ARENA, moving to a new block up front when the
+     expected SIZE_HINT does not fit in the current one.  */
+  explicit arena_context (format_arena& arena, std::size_t size_hint = 0)
+    : format_context (arena.free_data (), arena.free_size (), &grow),
+      m_arena (arena)
+  {
+    if (size_hint > m_capacity)
+      {
+        m_arena.next_block (size_hint);
+        move_window (m_arena.free_data (), m_arena.free_size ());
+      }
+  }
+
+  /* The formatted string, valid until the arena is reset.  */
+  std::string_view finish () noexcept
+  {
+    m_arena.m_used += m_size;
+    return std::string_view (m_data, m_size);
+  }
+
+private:
+  /* Carry the partial string over to a block with room for twice as
+     much, so a long string is copied only a logarithmic number of
+     times.  */
+  static void grow (format_context& ctx, std::size_t min_extra)
+  {
+    auto& self = static_cast<arena_context&> (ctx);
+    format_arena& arena = self.m_arena;
+    internal::count_stat (io_stat::buffer_growths);
+    arena.next_block (2 * self.m_size + min_extra);
+    if (self.m_size > 0)
+      {
+        std::memcpy (arena.free_data (), self.m_data, self.m_size);
+      }
+    self.move_window (arena.free_data (), arena.free_size ());
+  }
+
+  format_arena& m_arena;
+};
+
+/* This thread's arena, for handlers that format a burst of strings and
+   reset () it when done.  */
+inline format_arena& thread_arena ()
+{
+  thread_local format_arena arena;
+  return arena;
+}
+
+/* Format into ARENA; the result is valid until the arena is reset.  */
+template<typename... Args>
+std::string_view format (format_arena& arena, compile_format_string fmt,
+                         const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  arena_context ctx (arena, fmt.size () + fargs.estimate_total_size ());
+
+  internal::vformat_to (ctx, fmt, fargs);
+  return ctx.finish ();
+}
+
+template<fixed_string Str, typename... Args>
+std::string_view format (format_arena& arena, compiled_string<Str> fmt,
+                         const Args&... args)
+{
+  arena_context ctx (arena, compiled_string<Str>::text_size
+                            + (format_arg (args).estimated_size () + ... + 0));
+
+  internal::compiled_format_to (ctx, fmt, args...);
+  return ctx.finish ();
+}
+
+/* Format into a std::pmr::string allocated through ALLOC, e.g. from a
+   std::pmr::monotonic_buffer_resource.  */
+template<typename... Args>
+std::pmr::string format (std::pmr::polymorphic_allocator<char> alloc,
+                         compile_format_string fmt, const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  std::pmr::string result (alloc);
+  result.reserve (fmt.size () + fargs.estimate_total_size ());
+  iterator_context<std::back_insert_iterator<std::pmr::string>> ctx
+    { std::back_inserter (result) };
+
+  internal::vformat_to (ctx, fmt, fargs);
+  std::move (ctx).out ();
+  return result;
+}
+
+template<fixed_string Str, typename... Args>
+std::pmr::string format (std::pmr::polymorphic_allocator<char> alloc,
+                         compiled_string<Str> fmt, const Args&... args)
+{
+  std::pmr::string result (alloc);
+  result.reserve (compiled_string<Str>::text_size
+                  + (format_arg (args).estimated_size () + ... + 0));
+  iterator_context<std::back_insert_iterator<std::pmr::string>> ctx
+    { std::back_inserter (result) };
+
+  internal::compiled_format_to (ctx, fmt, args...);
+  std::move (ctx).out ();
+  return result;
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_ARENA_HPP */
@@ -0,0 +1,552 @@
+/* async_file.hpp - Double-buffered asynchronous file output for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_ASYNC_FILE_HPP
+#define FASTIO_ASYNC_FILE_HPP
+
+#include "output.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define FASTIO_HAS_IO_URING 1
+#endif
+
+namespace fastio {
+
+/* How an async_file_writer hands its buffers to the kernel.  */
+enum class write_backend
+{
+  automatic,  /* io_uring when the kernel allows it, else thread.  */
+  io_uring,   /* IORING_OP_WRITE submissions; falls back if unavailable.  */
+  thread      /* pwrite(2) on a worker thread.  */
+};
+
+namespace internal
+{
+#ifdef FASTIO_HAS_IO_URING
+  /* Minimal io_uring on the raw system calls, enough to keep one write
+     in flight: no liburing needed.  */
+  class uring
+  {
+  public:
+    uring () = default;
+    uring (const uring&) = delete;
+    uring& operator= (const uring&) = delete;
+
+    ~uring ()
+    {
+      if (m_sqes != MAP_FAILED)
+        {
+          ::munmap (m_sqes, m_sqes_size);
+        }
+      if (m_cq != MAP_FAILED && m_cq != m_sq)
+        {
+          ::munmap (m_cq, m_cq_size);
+        }
+      if (m_sq != MAP_FAILED)
+        {
+          ::munmap (m_sq, m_sq_size);
+        }
+      if (m_fd >= 0)
+        {
+          ::close (m_fd);
+        }
+    }
+
+    /* Create the ring; false when the kernel or a seccomp filter
+       refuses io_uring.  */
+    bool setup ()
+    {
+      io_uring_params params {};
+      m_fd = static_cast<int> (::syscall (__NR_io_uring_setup, 2, &params));
+      if (m_fd < 0)
+        {
+          return false;
+        }
+      m_sq_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+      m_cq_size = params.cq_off.cqes
+                  + params.cq_entries * sizeof (io_uring_cqe);
+      bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+      if (single)
+        {
+          m_sq_size = m_cq_size = std::max (m_sq_size, m_cq_size);
+        }
+      m_sq = map (m_sq_size, IORING_OFF_SQ_RING);
+      m_cq = single ? m_sq : map (m_cq_size, IORING_OFF_CQ_RING);
+      m_sqes_size = params.sq_entries * sizeof (io_uring_sqe);
+      m_sqes = map (m_sqes_size, IORING_OFF_SQES);
+      if (m_sq == MAP_FAILED || m_cq == MAP_FAILED || m_sqes == MAP_FAILED)
+        {
+          return false;
+        }
+
+      char* sq = static_cast<char*> (m_sq);
+      char* cq = static_cast<char*> (m_cq);
+      m_sq_tail = reinterpret_cast<unsigned*> (sq + params.sq_off.tail);
+      m_sq_mask = *reinterpret_cast<unsigned*> (sq + params.sq_off.ring_mask);
+      m_sq_array = reinterpret_cast<unsigned*> (sq + params.sq_off.array);
+      m_cq_head = reinterpret_cast<unsigned*> (cq + params.cq_off.head);
+      m_cq_tail = reinterpret_cast<unsigned*> (cq + params.cq_off.tail);
+      m_cq_mask = *reinterpret_cast<unsigned*> (cq + params.cq_off.ring_mask);
+      m_cqes = reinterpret_cast<io_uring_cqe*> (cq + params.cq_off.cqes);
+      return true;
+    }
+
+    /* Queue a write of SIZE bytes at OFFSET (-1: the file position).  */
+    void start (int fd, const char* data, std::size_t size, std::int64_t offset)
+    {
+      unsigned tail = *m_sq_tail;
+      unsigned index = tail & m_sq_mask;
+      io_uring_sqe& sqe = static_cast<io_uring_sqe*> (m_sqes)[index];
+      std::memset (&sqe, 0, sizeof (sqe));
+      sqe.opcode = IORING_OP_WRITE;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<std::uint64_t> (data);
+      sqe.len = static_cast<std::uint32_t> (size);
+      sqe.off = static_cast<std::uint64_t> (offset);
+      m_sq_array[index] = index;
+      std::atomic_ref<unsigned> (*m_sq_tail).store (tail + 1,
+                                                    std::memory_order_release);
+      enter (1, 0, 0);
+    }
+
+    /* Wait for the write to complete; bytes written or -errno.  */
+    long wait ()
+    {
+      for (;;)
+        {
+          unsigned head = *m_cq_head;
+          if (head != std::atomic_ref<unsigned> (*m_cq_tail)
+                        .load (std::memory_order_acquire))
+            {
+              long result = m_cqes[head & m_cq_mask].res;
+              std::atomic_ref<unsigned> (*m_cq_head)
+                .store (head + 1, std::memory_order_release);
+              return result;
+            }
+          enter (0, 1, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+  private:
+    void* map (std::size_t size, off_t offset) const noexcept
+    {
+      return ::mmap (nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, m_fd, offset);
+    }
+
+    /* Retrying after EINTR is safe: the kernel never submits more
+       entries than the ring holds.  */
+    void enter (unsigned submit, unsigned wait, unsigned flags)
+    {
+      while (::syscall (__NR_io_uring_enter, m_fd, submit, wait, flags,
+                        nullptr, 0) < 0)
+        {
+          if (errno != EINTR)
+            {
+              throw std::system_error (errno, std::generic_category (),
+                                       "fastio: io_uring_enter failed");
+            }
+        }
+    }
+
+    int m_fd = -1;
+    void* m_sq = MAP_FAILED;
+    void* m_cq = MAP_FAILED;
+    void* m_sqes = MAP_FAILED;
+    std::size_t m_sq_size = 0;
+    std::size_t m_cq_size = 0;
+    std::size_t m_sqes_size = 0;
+    unsigned* m_sq_tail = nullptr;
+    unsigned* m_sq_array = nullptr;
+    unsigned m_sq_mask = 0;
+    unsigned* m_cq_head = nullptr;
+    unsigned* m_cq_tail = nullptr;
+    unsigned m_cq_mask = 0;
+    io_uring_cqe* m_cqes = nullptr;
+  };
+#endif
+
+  /* Worker thread running one pwrite(2) (write(2) for offset -1) at a
+     time on behalf of the formatting thread.  */
+  class write_worker
+  {
+  public:
+    write_worker () : m_thread ([this] { run (); }) {}
+
+    write_worker (const write_worker&) = delete;
+    write_worker& operator= (const write_worker&) = delete;
+
+    ~write_worker ()
+    {
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_stop = true;
+      }
+      m_wake.notify_all ();
+      m_thread.join ();
+    }
+
+    void start (int fd, const char* data, std::size_t size, std::int64_t offset)
+    {
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_fd = fd;
+        m_data = data;
+        m_size = size;
+        m_offset = offset;
+        m_pending = true;
+      }
+      m_wake.notify_all ();
+    }
+
+    long wait ()
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      m_wake.wait (lock, [this] { return m_done; });
+      m_done = false;
+      return m_result;
+    }
+
+  private:
+    void run ()
+    {
+      std::unique_lock<std::mutex> lock (m_mutex);
+      for (;;)
+        {
+          m_wake.wait (lock, [this] { return m_pending || m_stop; });
+          if (!m_pending)
+            {
+              return;
+            }
+          m_pending = false;
+          lock.unlock ();
+          ssize_t n = m_offset < 0 ? ::write (m_fd, m_data, m_size)
+                                   : ::pwrite (m_fd, m_data, m_size, m_offset);
+          long result = n < 0 ? -errno : static_cast<long> (n);
+          lock.lock ();
+          m_result = result;
+          m_done = true;
+          m_wake.notify_all ();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    int m_fd = -1;
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    std::int64_t m_offset = 0;
+    long m_result = 0;
+    bool m_pending = false;
+    bool m_done = false;
+    bool m_stop = false;
+    std::thread m_thread;
+  };
+}
+
+/* Buffered file writer that overlaps formatting with the write(2)s.
+   Output is formatted into one of two buffers while the other is being
+   written asynchronously -- through io_uring when the kernel offers it,
+   by a worker thread otherwise -- so the formatting thread only waits
+   when it fills a buffer before the previous write has finished.  Works
+   with every fprint* function; its context is a format_context for
+   direct formatting.  Regular files are written at explicit offsets
+   starting at the current file position, which is moved past the
+   output on flush.  */
+class async_file_writer
+{
+public:
+  class context;
+
+  static constexpr std::size_t default_capacity = 1024 * 1024;
+
+  /* Create or truncate PATH and write to it; throws std::system_error
+     if it cannot be opened.  */
+  explicit async_file_writer (const std::string& path,
+                              std::size_t capacity = default_capacity,
+                              write_backend backend = write_backend::automatic)
+    : async_file_writer (::open (path.c_str (),
+                                 O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                 0666),
+                         capacity, backend, path)
+  {
+  }
+
+  /* Write to FD without taking ownership of it.  */
+  explicit async_file_writer (int fd,
+                              std::size_t capacity = default_capacity,
+                              write_backend backend = write_backend::automatic)
+    : async_file_writer (fd, capacity, backend, std::string ())
+  {
+  }
+
+  async_file_writer (const async_file_writer&) = delete;
+  async_file_writer& operator= (const async_file_writer&) = delete;
+
+  ~async_file_writer ()
+  {
+    try
+      {
+        flush ();
+      }
+    catch (...)
+      {
+      }
+    if (m_owns_fd)
+      {
+        ::close (m_fd);
+      }
+  }
+
+  void write (std::string_view data)
+  {
+    while (data.size () > m_capacity - m_size)
+      {
+        std::size_t n = m_capacity - m_size;
+        std::memcpy (m_active + m_size, data.data (), n);
+        m_size += n;
+        data.remove_prefix (n);
+        submit ();
+      }
+    std::memcpy (m_active + m_size, data.data (), data.size ());
+    m_size += data.size ();
+  }
+
+  void put (char ch)
+  {
+    if (m_size == m_capacity)
+      {
+        submit ();
+      }
+    m_active[m_size++] = ch;
+  }
+
+  /* Write everything so far and wait until the kernel has it.  */
+  void flush ()
+  {
+    submit ();
+    complete ();
+    if (m_offset >= 0)
+      {
+        ::lseek (m_fd, m_offset, SEEK_SET);
+      }
+  }
+
+  int fd () const noexcept { return m_fd; }
+
+  /* The backend in use: io_uring or thread, never automatic.  */
+  write_backend backend () const noexcept
+  {
+    return m_worker ? write_backend::thread : write_backend::io_uring;
+  }
+
+private:
+  async_file_writer (int fd, std::size_t capacity, write_backend backend,
+                     const std::string& path)
+    : m_fd (fd),
+      m_owns_fd (!path.empty ()),
+      m_capacity (capacity ? capacity : 1),
+      m_buffers (new char[2 * m_capacity]),
+      m_active (m_buffers.get ()),
+      m_offset (fd >= 0 ? ::lseek (fd, 0, SEEK_CUR) : -1)
+  {
+    if (m_fd < 0)
+      {
+        throw std::system_error (errno, std::generic_category (),
+                                 "fastio: cannot open " + path);
+      }
+#ifdef FASTIO_HAS_IO_URING
+    if (backend != write_backend::thread)
+      {
+        m_uring = std::make_unique<internal::uring> ();
+        if (!m_uring->setup ())
+          {
+            m_uring.reset ();
+          }
+      }
+#endif
+    if (!uses_uring ())
+      {
+        m_worker = std::make_unique<internal::write_worker> ();
+      }
+  }
+
+  bool uses_uring () const noexcept
+  {
+#ifdef FASTIO_HAS_IO_URING
+    return m_uring != nullptr;
+#else
+    return false;
+#endif
+  }
+
+  void start (const char* data, std::size_t size, std::int64_t offset)
+  {
+    size = std::min<std::size_t> (size, 1u << 30);
+#ifdef FASTIO_HAS_IO_URING
+    if (m_uring)
+      {
+        m_uring->start (m_fd, data, size, offset);
+        return;
+      }
+#endif
+    m_worker->start (m_fd, data, size, offset);
+  }
+
+  long wait ()
+  {
+#ifdef FASTIO_HAS_IO_URING
+    if (m_uring)
+      {
+        return m_uring->wait ();
+      }
+#endif
+    return m_worker->wait ();
+  }
+
+  /* Start writing the active buffer and switch to the other one, once
+     its own write has completed.  */
+  void submit ()
+  {
+    if (m_size == 0)
+      {
+        return;
+      }
+    internal::count_stat (io_stat::async_file_flushes);
+    complete ();
+    m_flight = m_active;
+    m_flight_size = m_size;
+    m_flight_offset = m_offset;
+    if (m_offset >= 0)
+      {
+        m_offset += static_cast<std::int64_t> (m_size);
+      }
+    start (m_flight, m_flight_size, m_flight_offset);
+    m_active = m_active == m_buffers.get () ? m_buffers.get () + m_capacity
+                                            : m_buffers.get ();
+    m_size = 0;
+  }
+
+  /* Wait for the write in flight, resubmitting the rest after a short
+     write.  A kernel without IORING_OP_WRITE gets the thread backend.  */
+  void complete ()
+  {
+    while (m_flight_size > 0)
+      {
+        long n = wait ();
+        if (n == -EINTR || n == -EAGAIN)
+          {
+            n = 0;
+          }
+        else if (n == -EINVAL && uses_uring ())
+          {
+#ifdef FASTIO_HAS_IO_URING
+            m_uring.reset ();
+#endif
+            m_worker = std::make_unique<internal::write_worker> ();
+            n = 0;
+          }
+        else if (n < 0)
+          {
+            m_flight_size = 0;
+            throw std::system_error (static_cast<int> (-n),
+                                     std::generic_category (),
+                                     "fastio: write failed");
+          }
+        auto done = static_cast<std::size_t> (n);
+        m_flight += done;
+        m_flight_size -= done;
+        if (m_flight_offset >= 0)
+          {
+            m_flight_offset += n;
+          }
+        if (m_flight_size > 0)
+          {
+            start (m_flight, m_flight_size, m_flight_offset);
+          }
+      }
+  }
+
+  int m_fd;
+  bool m_owns_fd;
+  std::size_t m_capacity;
+  std::unique_ptr<char[]> m_buffers;
+  char* m_active;
+  std::size_t m_size = 0;
+  std::int64_t m_offset;
+  const char* m_flight = nullptr;
+  std::size_t m_flight_size = 0;
+  std::int64_t m_flight_offset = 0;
+#ifdef FASTIO_HAS_IO_URING
+  std::unique_ptr<internal::uring> m_uring;
+#endif
+  std::unique_ptr<internal::write_worker> m_worker;
+};
+
+/* Format context over the active buffer of an async_file_writer.  Call
+   commit () once formatting succeeded; a full buffer is submitted and
+   formatting continues in the other one.  */
+class async_file_writer::context : public format_context
+{
+public:
+  explicit context (async_file_writer& writer) noexcept
+    : format_context (writer.m_active + writer.m_size,
+                      writer.m_capacity - writer.m_size, &grow),
+      m_writer (writer)
+  {
+  }
+
+  void commit () noexcept
+  {
+    m_writer.m_size += m_size;
+    set_window (m_writer.m_active + m_writer.m_size,
+                m_writer.m_capacity - m_writer.m_size);
+  }
+
+private:
+  static void grow (format_context& ctx, std::size_t)
+  {
+    auto& self = static_cast<context&> (ctx);
+    async_file_writer& writer = self.m_writer;
+    writer.m_size += self.m_size;
+    writer.submit ();
+    self.set_window (writer.m_active, writer.m_capacity);
+  }
+
+  async_file_writer& m_writer;
+};
+
+} /* namespace fastio */
+
+#endif /* FASTIO_ASYNC_FILE_HPP */
@@ -0,0 +1,429 @@
+/* async_logger.hpp - Asynchronous logging for FastIO.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_ASYNC_LOGGER_HPP
+#define FASTIO_ASYNC_LOGGER_HPP
+
+#include "core.hpp"
+#include "format.hpp"
+#include "output.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
+namespace fastio {
+
+/* What async_logger::log does when the ring buffer is full.  */
+enum class overflow_policy
+{
+  block,  /* Wait for the consumer to free a slot.  */
+  drop,   /* Discard the record and count it in dropped ().  */
+  grow    /* Format the record on the calling thread into an unbounded
+             overflow queue, written once the ring has drained.  */
+};
+
+/* Logger that moves formatting and writing off the calling threads.
+   Producers claim a slot in a bounded lock-free ring (Vyukov's
+   sequence-numbered MPMC queue, used here with a single consumer) and
+   store the format string's view and the raw arguments; string
+   arguments are copied into the slot, other non-arithmetic types are
+   formatted into it.  The format string itself is never copied: the
+   consumer thread runs vformat_to straight on the caller's literal,
+   appends a newline and writes records through a buffered fd_writer,
+   flushing when the ring runs empty.  */
+class async_logger
+{
+public:
+  static constexpr std::size_t max_args = 16;
+  static constexpr std::size_t default_capacity = 1024;
+
+  /* Log to FD through a ring of CAPACITY slots, rounded up to a power
+     of two.  */
+  explicit async_logger (int fd = STDOUT_FILENO,
+                         overflow_policy policy = overflow_policy::block,
+                         std::size_t capacity = default_capacity)
+    : m_policy (policy),
+      m_mask (std::bit_ceil (capacity < 2 ? 2 : capacity) - 1),
+      m_slots (new slot[m_mask + 1]),
+      m_writer (fd, flush_policy::manual)
+  {
+    for (std::size_t i = 0; i <= m_mask; ++i)
+      {
+        m_slots[i].sequence.store (i, std::memory_order_relaxed);
+      }
+    m_consumer = std::thread ([this] { run (); });
+  }
+
+  async_logger (const async_logger&) = delete;
+  async_logger& operator= (const async_logger&) = delete;
+
+  /* Write everything logged so far, then stop the consumer.  */
+  ~async_logger ()
+  {
+    m_stop.store (true, std::memory_order_release);
+    m_consumer.join ();
+  }
+
+  /* Queue one line.  Returns false if the record was dropped.  */
+  template<typename... Args>
+  bool log (compile_format_string fmt, const Args&... args)
+  {
+    static_assert (sizeof...(Args) <= max_args, "Too many format arguments");
+    std::string_view text (fmt.data (), fmt.size ());
+
+    if (!m_overflowing.load (std::memory_order_acquire))
+      {
+        for (;;)
+          {
+            std::size_t pos = m_tail.load (std::memory_order_relaxed);
+            for (;;)
+              {
+                slot& s = m_slots[pos & m_mask];
+                std::size_t seq = s.sequence.load (std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t> (seq - pos);
+                if (diff == 0)
+                  {
+                    if (m_tail.compare_exchange_weak (pos, pos + 1,
+                                                      std::memory_order_relaxed))
+                      {
+                        /* The slot is claimed, so it must be published
+                           even if copying the arguments throws, or the
+                           consumer would wait on it forever.  */
+                        bool captured = true;
+                        try
+                          {
+                            s.capture (text, args...);
+                          }
+                        catch (const std::exception& e)
+                          {
+                            s.fail (e.what ());
+                            captured = false;
+                          }
+                        catch (...)
+                          {
+                            s.fail ("unknown exception");
+                            captured = false;
+                          }
+                        s.sequence.store (pos + 1, std::memory_order_release);
+                        return captured;
+                      }
+                  }
+                else if (diff < 0)
+                  {
+                    break;
+                  }
+                else
+                  {
+                    pos = m_tail.load (std::memory_order_relaxed);
+                  }
+              }
+
+            /* Full.  */
+            if (m_policy == overflow_policy::drop)
+              {
+                m_dropped.fetch_add (1, std::memory_order_relaxed);
+                return false;
+              }
+            if (m_policy == overflow_policy::grow)
+              {
+                break;
+              }
+            std::this_thread::yield ();
+          }
+      }
+
+    std::string line;
+    bool formatted = true;
+    try
+      {
+        line = fastio::format (fmt, args...);
+      }
+    catch (const std::exception& e)
+      {
+        line = fastio::format ("fastio: format error: {}", e.what ());
+        formatted = false;
+      }
+    line.push_back ('\n');
+    std::lock_guard<std::mutex> lock (m_overflow_mutex);
+    m_overflow.push_back (std::move (line));
+    m_overflow_queued.fetch_add (1, std::memory_order_release);
+    m_overflowing.store (true, std::memory_order_release);
+    return formatted;
+  }
+
+  /* Block until every record logged before the call has been handed
+     to the kernel, overflow records included.  */
+  void flush ()
+  {
+    std::uint64_t overflow_target
+      = m_overflow_queued.load (std::memory_order_acquire);
+    std::size_t target = m_tail.load (std::memory_order_acquire);
+    std::size_t wanted = m_flush_target.load (std::memory_order_relaxed);
+    while (wanted < target
+           && !m_flush_target.compare_exchange_weak (wanted, target,
+                                                     std::memory_order_release))
+      {
+      }
+    while (m_synced.load (std::memory_order_acquire) < target
+           || m_overflow_synced.load (std::memory_order_acquire) < overflow_target)
+      {
+        std::this_thread::yield ();
+      }
+  }
+
+  /* Records discarded under overflow_policy::drop.  */
+  std::uint64_t dropped () const noexcept
+  {
+    return m_dropped.load (std::memory_order_relaxed);
+  }
+
+private:
+  struct alignas (64) slot
+  {
+    std::atomic<std::size_t> sequence;
+    std::string_view fmt;
+    std::array<format_arg, max_args> args;
+    std::size_t count;
+    std::string bytes;  /* Copied and preformatted arguments; keeps its
+                           capacity across reuse.  */
+
+    template<typename... Args>
+    void capture (std::string_view text, const Args&... values)
+    {
+      fmt = text;
+      count = sizeof...(Args);
+      bytes.clear ();
+      std::size_t offsets[sizeof...(Args) + 1];
+      std::size_t sizes[sizeof...(Args) + 1];
+      std::size_t i = 0;
+      ((args[i] = stash (values, offsets[i], sizes[i]), ++i), ...);
+
+      /* Only now is BYTES final, so views into it can be taken.  */
+      for (std::size_t k = 0; k < sizeof...(Args); ++k)
+        {
+          if (sizes[k] != npos)
+            {
+              args[k] = format_arg (std::string_view (bytes.data () + offsets[k],
+                                                      sizes[k]));
+            }
+        }
+    }
+
+    /* Replace a capture that threw with a record stating the error.  */
+    void fail (const char* what) noexcept
+    {
+      fmt = "fastio: format error: {}";
+      count = 1;
+      try
+        {
+          bytes.assign (what);
+          args[0] = format_arg (std::string_view (bytes));
+        }
+      catch (...)
+        {
+          args[0] = format_arg (std::string_view ("out of memory"));
+        }
+    }
+
+    static constexpr std::size_t npos = std::size_t (-1);
+
+    /* Keep arithmetic values as they are; copy strings and format
+       anything else into BYTES, recording where it went (SIZE stays
+       npos for values kept as they are).  */
+    template<typename T>
+    format_arg stash (const T& value, std::size_t& offset, std::size_t& size)
+    {
+      format_arg arg (value);
+      offset = bytes.size ();
+      size = npos;
+      if constexpr (std::is_convertible_v<T, std::string_view>)
+        {
+          bytes.append (std::string_view (value));
+          size = bytes.size () - offset;
+        }
+      else if (arg.type () == arg_type::custom)
+        {
+          iterator_context<std::back_insert_iterator<std::string>> ctx (
+            std::back_inserter (bytes));
+          arg.format (ctx);
+          std::move (ctx).out ();
+          size = bytes.size () - offset;
+        }
+      return arg;
+    }
+  };
+
+  void run ()
+  {
+    std::size_t head = 0;
+    int idle = 0;
+    for (;;)
+      {
+        slot& s = m_slots[head & m_mask];
+        if (s.sequence.load (std::memory_order_acquire) == head + 1)
+          {
+            write_record (s);
+            s.sequence.store (head + m_mask + 1, std::memory_order_release);
+            ++head;
+            if (m_synced.load (std::memory_order_relaxed)
+                < m_flush_target.load (std::memory_order_acquire))
+              {
+                sync (head);
+              }
+            idle = 0;
+            continue;
+          }
+
+        /* Ring drained as far as published records go.  The overflow
+           queue is only taken once nothing is claimed either, so each
+           producer's records stay in order.  */
+        if (m_overflowing.load (std::memory_order_acquire)
+            && m_tail.load (std::memory_order_acquire) == head)
+          {
+            drain_overflow (head);
+            continue;
+          }
+
+        sync (head);
+        if (m_stop.load (std::memory_order_acquire)
+            && m_tail.load (std::memory_order_acquire) == head
+            && !m_overflowing.load (std::memory_order_acquire))
+          {
+            return;
+          }
+        if (++idle < 64)
+          {
+            std::this_thread::yield ();
+          }
+        else
+          {
+            std::this_thread::sleep_for (std::chrono::microseconds (100));
+          }
+      }
+  }
+
+  /* A record that fails to format is dropped and replaced by a line
+     with the error.  */
+  void write_record (const slot& s)
+  {
+    try
+      {
+        fd_writer::context ctx (m_writer);
+        format_args<max_args> args (
+          std::span<const format_arg> (s.args.data (), s.count));
+        internal::vformat_to (ctx, s.fmt, args);
+        ctx.push_back ('\n');
+        ctx.commit ();
+      }
+    catch (const std::exception& e)
+      {
+        write_error (e.what ());
+      }
+  }
+
+  void write_error (const char* what) noexcept
+  {
+    try
+      {
+        fd_writer::context ctx (m_writer);
+        ctx.append ("fastio: format error: ");
+        ctx.append (what);
+        ctx.push_back ('\n');
+        ctx.commit ();
+      }
+    catch (...)
+      {
+      }
+  }
+
+  /* Write out the overflow queue.  Its records only count as synced
+     once they have left the writer's buffer as well.  */
+  void drain_overflow (std::size_t head)
+  {
+    std::deque<std::string> lines;
+    std::uint64_t queued;
+    {
+      std::lock_guard<std::mutex> lock (m_overflow_mutex);
+      lines.swap (m_overflow);
+      queued = m_overflow_queued.load (std::memory_order_relaxed);
+      m_overflowing.store (false, std::memory_order_release);
+    }
+    for (const std::string& line : lines)
+      {
+        try
+          {
+            m_writer.write (line);
+          }
+        catch (...)
+          {
+          }
+      }
+    sync (head);
+    m_overflow_synced.store (queued, std::memory_order_release);
+  }
+
+  /* Hand buffered output to the kernel; the first HEAD records are
+     then out.  */
+  void sync (std::size_t head)
+  {
+    try
+      {
+        m_writer.flush ();
+      }
+    catch (...)
+      {
+      }
+    m_synced.store (head, std::memory_order_release);
+  }
+
+  overflow_policy m_policy;
+  std::size_t m_mask;
+  std::unique_ptr<slot[]> m_slots;
+  fd_writer m_writer;
+
+  alignas (64) std::atomic<std::size_t> m_tail {0};
+  alignas (64) std::atomic<std::size_t> m_synced {0};
+  std::atomic<std::size_t> m_flush_target {0};
+  std::atomic<std::uint64_t> m_dropped {0};
+  std::atomic<bool> m_stop {false};
+
+  std::mutex m_overflow_mutex;
+  std::deque<std::string> m_overflow;
+  std::atomic<bool> m_overflowing {false};
+  std::atomic<std::uint64_t> m_overflow_queued {0};
+  std::atomic<std::uint64_t> m_overflow_synced {0};
+
+  std::thread m_consumer;
+};
+
+} /* namespace fastio */
+
+#endif /* FASTIO_ASYNC_LOGGER_HPP */
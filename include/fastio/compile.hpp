@@ -0,0 +1,315 @@
+/* compile.hpp - Compile-time pre-parsed format strings for FastIO.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_COMPILE_HPP
+#define FASTIO_COMPILE_HPP
+
+#include "format.hpp"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+namespace fastio {
+
+/* String literal usable as a non-type template parameter.  */
+template<std::size_t N>
+struct fixed_string
+{
+  consteval fixed_string (const char (&str)[N])
+  {
+    std::copy_n (str, N, data);
+  }
+
+  constexpr std::size_t size () const noexcept { return N - 1; }
+
+  constexpr std::string_view view () const noexcept
+  {
+    return std::string_view (data, N - 1);
+  }
+
+  char data[N] {};
+};
+
+namespace internal
+{
+  /* Walk FMT once, reporting every literal character (with escaped
+     braces already collapsed) and the text of every placeholder.  */
+  template<typename OnText, typename OnArg>
+  constexpr void scan_format (std::string_view fmt, OnText on_text, OnArg on_arg)
+  {
+    std::size_t i = 0;
+    while (i < fmt.size ())
+      {
+        if (fmt[i] == '{')
+          {
+            if (i + 1 < fmt.size () && fmt[i + 1] == '{')
+              {
+                on_text ('{');
+                i += 2;
+                continue;
+              }
+            std::size_t close = i + 1;
+            while (close < fmt.size () && fmt[close] != '}')
+              {
+                ++close;
+              }
+            if (close == fmt.size ())
+              {
+                throw "Unclosed placeholder in format string";
+              }
+            on_arg (fmt.substr (i + 1, close - i - 1));
+            i = close + 1;
+          }
+        else if (fmt[i] == '}')
+          {
+            if (i + 1 < fmt.size () && fmt[i + 1] == '}')
+              {
+                on_text ('}');
+                i += 2;
+                continue;
+              }
+            throw "Unmatched '}' in format string";
+          }
+        else
+          {
+            on_text (fmt[i]);
+            ++i;
+          }
+      }
+  }
+}
+
+/* Format string pre-parsed at compile time.  The literal text between
+   placeholders is stored unescaped in TEXT; segment K spans
+   [OFFSETS[K], OFFSETS[K + 1]) and precedes argument K, which is
+   formatted according to SPECS[K].  */
+template<fixed_string Str>
+struct compiled_string
+{
+private:
+  struct layout_counts
+  {
+    std::size_t args = 0;
+    std::size_t text = 0;
+  };
+
+  static consteval layout_counts count ()
+  {
+    layout_counts counts;
+    internal::scan_format (Str.view (),
+                           [&] (char) { ++counts.text; },
+                           [&] (std::string_view) { ++counts.args; });
+    return counts;
+  }
+
+  static constexpr layout_counts counts = count ();
+
+public:
+  static constexpr std::size_t arg_count = counts.args;
+  static constexpr std::size_t text_size = counts.text;
+
+  static constexpr std::array<char, text_size> text = [] {
+    std::array<char, text_size> out {};
+    std::size_t n = 0;
+    internal::scan_format (Str.view (),
+                           [&] (char ch) { out[n++] = ch; },
+                           [] (std::string_view) {});
+    return out;
+  } ();
+
+  static constexpr std::array<std::size_t, arg_count + 2> offsets = [] {
+    std::array<std::size_t, arg_count + 2> out {};
+    std::size_t n = 0;
+    std::size_t k = 1;
+    internal::scan_format (Str.view (),
+                           [&] (char) { ++n; },
+                           [&] (std::string_view) { out[k++] = n; });
+    out[k] = n;
+    return out;
+  } ();
+
+  static constexpr std::array<format_spec, arg_count> specs = [] {
+    std::array<format_spec, arg_count> out {};
+    std::size_t k = 0;
+    internal::scan_format (Str.view (),
+                           [] (char) {},
+                           [&] (std::string_view field) {
+                             if (!parse_format_spec (field, out[k++]))
+                               {
+                                 throw "Invalid format specifier";
+                               }
+                           });
+    return out;
+  } ();
+
+  /* Length of literal segment K.  */
+  static constexpr std::size_t segment_size (std::size_t k) noexcept
+  {
+    return offsets[k + 1] - offsets[k];
+  }
+};
+
+/* Compiled format string literal: fastio::compiled<"{} + {}">.  */
+template<fixed_string Str>
+inline constexpr compiled_string<Str> compiled {};
+
+namespace internal
+{
+  /* Emit literal segment I of a compiled format string.  */
+  template<typename Compiled, std::size_t I>
+  constexpr void append_segment (format_context& ctx)
+  {
+    constexpr std::size_t size = Compiled::segment_size (I);
+    if constexpr (size == 1)
+      {
+        ctx.push_back (Compiled::text[Compiled::offsets[I]]);
+      }
+    else if constexpr (size > 0)
+      {
+        ctx.append (std::string_view (Compiled::text.data ()
+                                      + Compiled::offsets[I], size));
+      }
+  }
+
+  /* Emit argument I, taking the plain path when it has no spec.  */
+  template<typename Compiled, std::size_t I, typename T>
+  constexpr void append_field (format_context& ctx, const T& value)
+  {
+    if constexpr (Compiled::specs[I].is_default ())
+      {
+        format_value_to (ctx, value);
+      }
+    else
+      {
+        format_value_to (ctx, value, Compiled::specs[I]);
+      }
+  }
+
+  /* Straight-line sequence of literal copies and typed writers.  */
+  template<typename Compiled, std::size_t... I, typename... Args>
+  constexpr void compiled_format_to (format_context& ctx,
+                                     std::index_sequence<I...>,
+                                     const Args&... args)
+  {
+    ((append_segment<Compiled, I> (ctx),
+      append_field<Compiled, I> (ctx, args)), ...);
+    append_segment<Compiled, sizeof...(I)> (ctx);
+  }
+
+  template<typename Compiled, std::size_t... I, typename... Args>
+  constexpr std::size_t compiled_size (std::index_sequence<I...>,
+                                       const Args&... args)
+  {
+    return Compiled::text_size
+           + (format_arg (args).formatted_size (Compiled::specs[I]) + ... + 0);
+  }
+}
+
+namespace internal
+{
+  /* Run a compiled format string into CTX, checking the argument count.  */
+  template<fixed_string Str, typename... Args>
+  constexpr void compiled_format_to (format_context& ctx,
+                                     compiled_string<Str>,
+                                     const Args&... args)
+  {
+    using compiled_type = compiled_string<Str>;
+    static_assert (sizeof...(Args) == compiled_type::arg_count,
+                   "Number of arguments does not match the format string");
+
+    const std::size_t start = ctx.size ();
+    compiled_format_to<compiled_type> (ctx,
+                                       std::index_sequence_for<Args...> {},
+                                       args...);
+    count_format (ctx, start);
+  }
+}
+
+/* Exact output length for a compiled format string.  */
+template<fixed_string Str, typename... Args>
+constexpr std::size_t formatted_size (compiled_string<Str>, const Args&... args)
+{
+  static_assert (sizeof...(Args) == compiled_string<Str>::arg_count,
+                 "Number of arguments does not match the format string");
+  return internal::compiled_size<compiled_string<Str>> (
+    std::index_sequence_for<Args...> {}, args...);
+}
+
+/* Format with a compiled format string.  */
+template<fixed_string Str, typename... Args>
+std::string format (compiled_string<Str> fmt, const Args&... args)
+{
+#ifdef FASTIO_EXACT_SIZING
+  format_context ctx (formatted_size (fmt, args...));
+#else
+  std::size_t estimated_size = compiled_string<Str>::text_size
+                               + (format_arg (args).estimated_size () + ... + 0);
+  format_context ctx (estimated_size);
+#endif
+
+  internal::compiled_format_to (ctx, fmt, args...);
+#ifndef FASTIO_EXACT_SIZING
+  if (ctx.size () > estimated_size) [[unlikely]]
+    {
+      internal::count_stat (io_stat::estimate_misses);
+    }
+#endif
+  return std::move (ctx).str ();
+}
+
+template<fixed_string Str, typename... Args>
+constexpr char* format_to (char* out, compiled_string<Str> fmt,
+                           const Args&... args)
+{
+  fixed_buffer_context ctx (out, std::numeric_limits<std::size_t>::max () / 2);
+
+  internal::compiled_format_to (ctx, fmt, args...);
+  return out + ctx.size ();
+}
+
+template<typename OutputIt, fixed_string Str, typename... Args>
+  requires std::output_iterator<OutputIt, char>
+OutputIt format_to (OutputIt out, compiled_string<Str> fmt, const Args&... args)
+{
+  iterator_context<OutputIt> ctx (std::move (out));
+
+  internal::compiled_format_to (ctx, fmt, args...);
+  return std::move (ctx).out ();
+}
+
+template<fixed_string Str, typename... Args>
+constexpr void format_to (format_context& ctx, compiled_string<Str> fmt,
+                          const Args&... args)
+{
+  internal::compiled_format_to (ctx, fmt, args...);
+}
+
+template<fixed_string Str, typename... Args>
+constexpr format_to_n_result<char*> format_to_n (char* out, std::size_t n,
+                                                 compiled_string<Str> fmt,
+                                                 const Args&... args)
+{
+  fixed_buffer_context ctx (out, n);
+
+  internal::compiled_format_to (ctx, fmt, args...);
+  return { out + ctx.stored (), ctx.size () };
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_COMPILE_HPP */
@@ -24,28 +24,154 @@
 #include <string_view>
 #include <string>
 #include <memory>
+#include <cstdint>
 
 namespace fastio {
 
 /* Forward declarations for format context.  */
 class format_context;
+class format_arg;
 
-/* Base class for format arguments.  */
-class format_arg_base
+namespace internal
 {
-public:
-  virtual ~format_arg_base () = default;
-  virtual void format (format_context& ctx) const = 0;
-  virtual std::size_t estimated_size () const = 0;
+  template<typename T>
+  constexpr void format_value_to (format_context& ctx, const T& value);
+}
+
+/* Customization point for user types.  A specialization provides
+   format (value, ctx), writing VALUE straight into the context, and
+   optionally size_hint (value), an estimate of the formatted length
+   used to reserve output space.  */
+template<typename T>
+struct formatter;
+
+/* Types with a formatter specialization.  */
+template<typename T>
+concept has_formatter = requires (const T& value, format_context& ctx)
+{
+  formatter<T> {}.format (value, ctx);
 };
 
-namespace internal
+/* Parsed replacement field specification:
+   [[fill]align][sign][#][0][width][.precision][type].  */
+struct format_spec
 {
-  template<typename T>
-  void format_value_to (format_context& ctx, const T& value);
+  char fill = ' ';
+  char align = 0;          /* '<', '>', '^' or 0 for the type's default.  */
+  char sign = 0;           /* '+', ' ', '-' or 0.  */
+  bool alternate = false;  /* '#': radix prefix.  */
+  bool zero_pad = false;   /* '0': pad numbers with zeros after the sign.  */
+  char type = 0;
+  std::uint16_t width = 0;
+  std::int16_t precision = -1;
+
+  constexpr bool is_default () const noexcept
+  {
+    return align == 0 && sign == 0 && !alternate && !zero_pad
+           && type == 0 && width == 0 && precision < 0;
+  }
+};
+
+/* Parse the text between the braces of a replacement field into SPEC.
+   Returns false if the specification is malformed, or if it starts
+   with an argument id: arguments are always consumed in order, so
+   "{1} {0}" is rejected rather than formatted in the wrong order.  */
+constexpr bool parse_format_spec (std::string_view field, format_spec& spec) noexcept
+{
+  if (field.empty ())
+    {
+      return true;
+    }
+  if (field[0] != ':')
+    {
+      return false;
+    }
+
+  std::string_view text = field.substr (1);
+  std::size_t i = 0;
+  auto is_align = [] (char ch) { return ch == '<' || ch == '>' || ch == '^'; };
+  auto is_digit = [] (char ch) { return ch >= '0' && ch <= '9'; };
+
+  if (text.size () >= 2 && is_align (text[1]))
+    {
+      spec.fill = text[0];
+      spec.align = text[1];
+      i = 2;
+    }
+  else if (!text.empty () && is_align (text[0]))
+    {
+      spec.align = text[0];
+      i = 1;
+    }
+
+  if (i < text.size () && (text[i] == '+' || text[i] == '-' || text[i] == ' '))
+    {
+      spec.sign = text[i++];
+    }
+  if (i < text.size () && text[i] == '#')
+    {
+      spec.alternate = true;
+      ++i;
+    }
+  if (i < text.size () && text[i] == '0')
+    {
+      spec.zero_pad = true;
+      ++i;
+    }
+
+  unsigned width = 0;
+  for (; i < text.size () && is_digit (text[i]); ++i)
+    {
+      width = width * 10 + (text[i] - '0');
+      if (width > 0xffff)
+        {
+          return false;
+        }
+    }
+  spec.width = static_cast<std::uint16_t> (width);
+
+  if (i < text.size () && text[i] == '.')
+    {
+      ++i;
+      if (i == text.size () || !is_digit (text[i]))
+        {
+          return false;
+        }
+      int precision = 0;
+      for (; i < text.size () && is_digit (text[i]); ++i)
+        {
+          precision = precision * 10 + (text[i] - '0');
+          if (precision > 0x7fff)
+            {
+              return false;
+            }
+        }
+      spec.precision = static_cast<std::int16_t> (precision);
+    }
+
+  if (i < text.size ())
+    {
+      constexpr std::string_view types = "sbBcdoxXeEfFgGaA";
+      bool known = false;
+      for (char type : types)
+        {
+          known = known || type == text[i];
+        }
+      if (!known)
+        {
+          return false;
+        }
+      spec.type = text[i++];
+    }
+
+  return i == text.size ();
 }
 
-/* Compile-time format string with validation.  */
+/* Compile-time format string with validation.  The constructor checks
+   the braces and every field's specification, and notes whether any
+   field has one, so strings of plain {} fields are formatted without
+   looking at specs at all.  The object stays a few words, cheap to pass
+   by value; compiled<"..."> keeps a full pre-parsed layout instead.  */
 class compile_format_string
 {
 public:
@@ -56,14 +182,26 @@ public:
     validate ();
   }
 
-  const char* data () const noexcept { return data_; }
-  std::size_t size () const noexcept { return size_; }
+  constexpr const char* data () const noexcept { return data_; }
+  constexpr std::size_t size () const noexcept { return size_; }
+
+  /* Number of placeholders.  */
+  constexpr std::size_t arg_count () const noexcept { return arg_count_; }
+
+  /* Length of the literal output, with escaped braces collapsed.  */
+  constexpr std::size_t literal_size () const noexcept { return literal_size_; }
+
+  /* Whether any field carries a non-default specification.  */
+  constexpr bool has_specs () const noexcept { return has_specs_; }
 
 private:
-  constexpr void validate () const;
+  constexpr void validate ();
 
   const char* data_;
   std::size_t size_;
+  std::size_t arg_count_ = 0;
+  std::size_t literal_size_ = 0;
+  bool has_specs_ = false;
 };
 
 /* Type traits for efficient integer formatting.  */
@@ -82,14 +220,13 @@ inline constexpr bool is_integral_like_v = is_integral_like<T>::value;
 /* Concept for types that can be formatted.  */
 template<typename T>
 concept formattable = std::convertible_to<T, std::string_view> ||
+                     has_formatter<T> ||
                      requires (const T& val) {
                        { std::to_string (val) } -> std::convertible_to<std::string>;
                      };
 
-constexpr void compile_format_string::validate () const
+constexpr void compile_format_string::validate ()
 {
-  int braces = 0;
-  
   for (std::size_t i = 0; i < size_; ++i)
     {
       if (data_[i] == '{')
@@ -97,28 +234,41 @@ constexpr void compile_format_string::validate () const
           if (i + 1 < size_ && data_[i + 1] == '{')
             {
               ++i;
+              ++literal_size_;
               continue;
             }
-          ++braces;
+          std::size_t open = i;
+          while (i < size_ && data_[i] != '}')
+            {
+              ++i;
+            }
+          if (i == size_)
+            {
+              throw "Unmatched '{' in format string";
+            }
+          format_spec spec;
+          if (!parse_format_spec (std::string_view (data_ + open + 1,
+                                                    i - open - 1), spec))
+            {
+              throw "Invalid format specifier";
+            }
+          has_specs_ = has_specs_ || !spec.is_default ();
+          ++arg_count_;
         }
       else if (data_[i] == '}')
         {
           if (i + 1 < size_ && data_[i + 1] == '}')
             {
               ++i;
+              ++literal_size_;
               continue;
             }
-          --braces;
-          if (braces < 0)
-            {
-              throw "Unmatched '}' in format string";
-            }
+          throw "Unmatched '}' in format string";
+        }
+      else
+        {
+          ++literal_size_;
         }
-    }
-  
-  if (braces > 0)
-    {
-      throw "Unmatched '{' in format string";
     }
 }
 
@@ -21,8 +21,21 @@
 
 #include "core.hpp"
 #include "format.hpp"
+#include "compile.hpp"
+#include "arena.hpp"
+#include "small_string.hpp"
+#include "ranges.hpp"
+#include "output.hpp"
 #include "print.hpp"
+#include "scan.hpp"
+#include "hex.hpp"
+#include "parse.hpp"
 #include "input.hpp"
+#include "mapped_file.hpp"
+#include "async_logger.hpp"
+#include "async_file.hpp"
+#include "stats.hpp"
+#include "timing.hpp"
 #include <chrono>
 #include <algorithm>
 
@@ -48,12 +61,17 @@ private:
   std::chrono::time_point<std::chrono::high_resolution_clock> start_;
 };
 
+/* Parse the integer STR starts with, ignoring anything after it as
+   std::from_chars does, so "12 " gives 12.  Throws when STR does not
+   start with a number or the number does not fit in T; try_parse_int
+   is the strict form that rejects trailing characters.  */
 template<typename T>
-  requires std::integral<T>
+  requires parsable_integer<T>
 inline T parse_int(std::string_view str)
 {
   T value;
-  auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+  auto [ptr, ec] = internal::parse_integer(str.data(), str.data() + str.size(),
+                                           value);
 
   if (ec != std::errc())
     {
@@ -63,30 +81,21 @@ inline T parse_int(std::string_view str)
   return value;
 }
 
+/* Write VALUE in decimal at BUFFER, which needs room for
+   internal::max_decimal_size<T> bytes, and return the end.  A bool is
+   written as the 0 or 1 it promotes to.  */
 template<typename T>
   requires std::integral<T>
-inline char* write_int(char* buffer, T value)
+constexpr char* write_int(char* buffer, T value)
 {
-  if constexpr (std::signed_integral<T>)
+  if constexpr (std::is_same_v<T, bool>)
     {
-      if (value < 0)
-        {
-          *buffer++ = '-';
-          return write_int(buffer, static_cast<std::make_unsigned_t<T>>(-value));
-        }
+      return internal::write_decimal(buffer, static_cast<unsigned>(value));
     }
-
-  char* start = buffer;
-
-  do
+  else
     {
-      *buffer++ = static_cast<char>('0' + (value % 10));
-      value /= 10;
+      return internal::write_decimal(buffer, value);
     }
-  while (value > 0);
-
-  std::reverse(start, buffer);
-  return buffer;
 }
 
 } // namespace fastio
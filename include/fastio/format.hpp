@@ -20,176 +20,847 @@
 #define FASTIO_FORMAT_HPP
 
 #include "core.hpp"
+#include "stats.hpp"
+#include "hex.hpp"
 #include <charconv>
 #include <sstream>
-#include <memory>
 #include <vector>
 #include <stdexcept>
 #include <array>
 #include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <bit>
+#include <cstdint>
+#include <span>
 
 namespace fastio {
 
-/* Optimized format context with pre-allocation.  */
+namespace internal
+{
+  /* Number of decimal digits in VALUE.  bit_width * log10(2) gives the
+     count or one less; a single power-of-ten compare settles it.  */
+  constexpr std::size_t count_digits (std::uint64_t value) noexcept
+  {
+    constexpr std::uint64_t powers[] = {
+      0, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+      10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+      100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+      100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+      100000000000000000ULL, 1000000000000000000ULL,
+      10000000000000000000ULL
+    };
+    std::size_t t = (static_cast<std::size_t> (std::bit_width (value | 1))
+                     * 1233) >> 12;
+    return t + (value >= powers[t]);
+  }
+
+  /* "00" "01" ... "99": two digits per table lookup.  */
+  inline constexpr std::array<char, 200> digit_pairs = [] {
+    std::array<char, 200> table {};
+    for (int i = 0; i < 100; ++i)
+      {
+        table[2 * i] = static_cast<char> ('0' + i / 10);
+        table[2 * i + 1] = static_cast<char> ('0' + i % 10);
+      }
+    return table;
+  } ();
+
+  /* Write the decimal digits of VALUE so that they end just before END,
+     two per division; returns the first digit.  Values that fit 32 bits
+     use 32-bit arithmetic.  */
+  template<typename U>
+  constexpr char* write_digits_backward (char* end, U value) noexcept
+  {
+    using word = std::conditional_t<(sizeof (U) <= 4), std::uint32_t,
+                                    std::uint64_t>;
+    word n = value;
+    while (n >= 100)
+      {
+        std::size_t i = static_cast<std::size_t> (n % 100) * 2;
+        n /= 100;
+        *--end = digit_pairs[i + 1];
+        *--end = digit_pairs[i];
+      }
+    if (n >= 10)
+      {
+        std::size_t i = static_cast<std::size_t> (n) * 2;
+        *--end = digit_pairs[i + 1];
+        *--end = digit_pairs[i];
+      }
+    else
+      {
+        *--end = static_cast<char> ('0' + n);
+      }
+    return end;
+  }
+
+  /* memcpy and memset, with plain loops during constant evaluation
+     where the C library functions cannot run.  */
+  constexpr void copy_chars (char* out, const char* in, std::size_t n) noexcept
+  {
+    if (std::is_constant_evaluated ())
+      {
+        std::copy_n (in, n, out);
+        return;
+      }
+    std::memcpy (out, in, n);
+  }
+
+  constexpr void fill_chars (char* out, std::size_t n, char ch) noexcept
+  {
+    if (std::is_constant_evaluated ())
+      {
+        std::fill_n (out, n, ch);
+        return;
+      }
+    std::memset (out, ch, n);
+  }
+
+  /* Longest decimal form of T, sign included.  */
+  template<typename T>
+  inline constexpr std::size_t max_decimal_size
+    = std::numeric_limits<T>::digits10 + 2;
+
+  /* Write VALUE in decimal at OUT and return the end.  The length is
+     counted up front, so digits land in place with no reversal; the
+     magnitude of a negative value is taken in unsigned arithmetic,
+     which is well defined for the minimum value too.  */
+  template<typename T>
+    requires std::integral<T>
+  constexpr char* write_decimal (char* out, T value) noexcept
+  {
+    using unsigned_type = std::make_unsigned_t<T>;
+    unsigned_type magnitude = static_cast<unsigned_type> (value);
+    if constexpr (std::is_signed_v<T>)
+      {
+        if (value < 0)
+          {
+            *out++ = '-';
+            magnitude = unsigned_type (0) - magnitude;
+          }
+      }
+    char* end = out + count_digits (magnitude);
+    write_digits_backward (end, magnitude);
+    return end;
+  }
+}
+
+/* Optimized format context with pre-allocation.  The context writes
+   into a window [data, data + capacity) of its sink; when the window is
+   full the sink's grow hook either enlarges it or hands the bytes off
+   and provides a fresh one.  By default the sink is an owned string.  */
 class format_context
 {
 public:
   /* Constructor with initial capacity.  */
   explicit format_context (std::size_t initial_capacity = 256)
+    : m_grow (&grow_string)
   {
-    m_buffer.reserve (initial_capacity);
+    resize_string (initial_capacity);
   }
 
+  format_context (const format_context&) = delete;
+  format_context& operator= (const format_context&) = delete;
+
   /* Append single character.  */
-  void push_back (char ch)
+  constexpr void push_back (char ch)
   {
-    m_buffer.push_back (ch);
+    if (m_size == m_capacity) [[unlikely]]
+      {
+        m_grow (*this, 1);
+      }
+    m_data[m_size++] = ch;
   }
 
   /* Append string view - optimized for small strings.  */
-  void append (std::string_view str)
+  constexpr void append (std::string_view str)
   {
-    m_buffer.append (str);
+    if (str.size () > m_capacity - m_size) [[unlikely]]
+      {
+        append_slow (str);
+        return;
+      }
+    internal::copy_chars (m_data + m_size, str.data (), str.size ());
+    m_size += str.size ();
+  }
+
+  /* Append COUNT copies of CH, filling the window in bulk.  */
+  constexpr void append (std::size_t count, char ch)
+  {
+    while (count > m_capacity - m_size) [[unlikely]]
+      {
+        std::size_t n = m_capacity - m_size;
+        internal::fill_chars (m_data + m_size, n, ch);
+        m_size += n;
+        count -= n;
+        m_grow (*this, count);
+      }
+    internal::fill_chars (m_data + m_size, count, ch);
+    m_size += count;
   }
 
-  /* Get resulting string (move semantics).  */
+  /* Append STR, the contents of a string argument that does not own
+     its characters (see internal::borrowable_string).  Sinks that
+     gather output may keep a reference to a large one instead of
+     copying it.  */
+  constexpr void append_string (std::string_view str)
+  {
+    if (str.size () >= m_borrow_min) [[unlikely]]
+      {
+        m_borrow (*this, str);
+        return;
+      }
+    append (str);
+  }
+
+  /* Append VALUE in decimal, written straight into the window when it
+     has room for the longest possible result.  */
+  template<typename T>
+    requires std::integral<T>
+  constexpr void append_decimal (T value)
+  {
+    if (m_capacity - m_size >= internal::max_decimal_size<T>) [[likely]]
+      {
+        m_size = internal::write_decimal (m_data + m_size, value) - m_data;
+        return;
+      }
+    char buffer[internal::max_decimal_size<T>];
+    append (std::string_view (buffer,
+                              internal::write_decimal (buffer, value) - buffer));
+  }
+
+  /* Append the N bytes at DATA as hex digits, encoded straight into
+     the window a stretch at a time.  */
+  void append_hex (const std::byte* data, std::size_t n, bool upper = false)
+  {
+    while (n != 0)
+      {
+        std::size_t room = (m_capacity - m_size) / 2;
+        if (room == 0) [[unlikely]]
+          {
+            /* Let append split a byte that straddles the window end.  */
+            char pair[2];
+            internal::encode_hex (pair, data, 1, upper);
+            append (std::string_view (pair, 2));
+            ++data;
+            --n;
+            continue;
+          }
+        std::size_t count = std::min (room, n);
+        m_size = internal::encode_hex (m_data + m_size, data, count, upper)
+                 - m_data;
+        data += count;
+        n -= count;
+      }
+  }
+
+  /* Get resulting string (move semantics).  Only meaningful for the
+     default string sink.  */
   std::string str () &&
   {
-    return std::move (m_buffer);
+    m_buffer.resize (m_size);
+    std::string result = std::move (m_buffer);
+    m_data = nullptr;
+    m_size = m_capacity = 0;
+    return result;
   }
 
   std::string str () const &
   {
-    return m_buffer;
+    return std::string (m_data, m_size);
   }
 
   /* Clear and reuse buffer.  */
-  void clear () noexcept
+  constexpr void clear () noexcept
+  {
+    m_size = 0;
+    m_flushed = 0;
+  }
+
+  /* Get current size: every byte produced so far, including bytes the
+     sink has already handed off or discarded.  */
+  constexpr std::size_t size () const noexcept
   {
-    m_buffer.clear ();
+    return m_flushed + m_size;
   }
 
-  /* Get current size.  */
-  std::size_t size () const noexcept
+protected:
+  /* Called when the window is full; must leave room for at least one
+     more byte, ideally for MIN_EXTRA.  */
+  using grow_function = void (*) (format_context& ctx, std::size_t min_extra);
+
+  /* Constructor for sinks that supply their own window.  */
+  constexpr format_context (char* data, std::size_t capacity,
+                            grow_function grow) noexcept
+    : m_data (data), m_capacity (capacity), m_grow (grow)
+  {
+  }
+
+  /* Called by append_string for strings of at least the size given to
+     set_borrow, in place of copying them.  */
+  using borrow_function = void (*) (format_context& ctx, std::string_view str);
+
+  constexpr void set_borrow (borrow_function borrow, std::size_t min_size) noexcept
+  {
+    m_borrow = borrow;
+    m_borrow_min = min_size;
+  }
+
+  /* Switch to a larger window that already holds a copy of the
+     current contents, as when a growable buffer is reallocated.  */
+  constexpr void move_window (char* data, std::size_t capacity) noexcept
+  {
+    m_data = data;
+    m_capacity = capacity;
+  }
+
+  /* Mark the current window as consumed and switch to a new one.  */
+  constexpr void set_window (char* data, std::size_t capacity) noexcept
   {
-    return m_buffer.size ();
+    m_flushed += m_size;
+    m_data = data;
+    m_size = 0;
+    m_capacity = capacity;
   }
 
+  char* m_data = nullptr;
+  std::size_t m_size = 0;
+  std::size_t m_capacity = 0;
+
 private:
+  constexpr void append_slow (std::string_view str)
+  {
+    while (!str.empty ())
+      {
+        if (m_size == m_capacity)
+          {
+            m_grow (*this, str.size ());
+          }
+        std::size_t n = std::min (str.size (), m_capacity - m_size);
+        internal::copy_chars (m_data + m_size, str.data (), n);
+        m_size += n;
+        str.remove_prefix (n);
+      }
+  }
+
+  void resize_string (std::size_t capacity)
+  {
+    m_buffer.resize_and_overwrite (capacity,
+                                   [] (char*, std::size_t n) { return n; });
+    m_data = m_buffer.data ();
+    m_capacity = m_buffer.size ();
+  }
+
+  static void grow_string (format_context& ctx, std::size_t min_extra)
+  {
+    internal::count_stat (io_stat::buffer_growths);
+    ctx.resize_string (std::max (ctx.m_capacity * 2,
+                                 ctx.m_size + min_extra));
+  }
+
+  std::size_t m_flushed = 0;
+  grow_function m_grow;
+  borrow_function m_borrow = nullptr;
+  std::size_t m_borrow_min = std::numeric_limits<std::size_t>::max ();
   std::string m_buffer;
 };
 
-/* Template class for typed format arguments with SBO.  */
-template<typename T>
-class format_arg : public format_arg_base
+/* Context writing into a caller-provided buffer of fixed capacity.
+   Output past the end is counted but discarded.  */
+class fixed_buffer_context : public format_context
 {
 public:
-  explicit format_arg (const T& value) : m_value (value) {}
+  constexpr fixed_buffer_context (char* out, std::size_t capacity) noexcept
+    : format_context (out, capacity, &discard), m_limit (capacity)
+  {
+  }
 
-  void format (format_context& ctx) const override
+  /* Number of bytes actually stored in the caller's buffer.  */
+  constexpr std::size_t stored () const noexcept
   {
-    internal::format_value_to (ctx, m_value);
+    return std::min (size (), m_limit);
   }
 
-  std::size_t estimated_size () const override
+  constexpr bool truncated () const noexcept
+  {
+    return size () > m_limit;
+  }
+
+private:
+  static constexpr void discard (format_context& ctx, std::size_t)
+  {
+    auto& self = static_cast<fixed_buffer_context&> (ctx);
+    self.set_window (self.m_scratch, sizeof (self.m_scratch));
+  }
+
+  std::size_t m_limit;
+  char m_scratch[64];
+};
+
+/* Context that only measures its output; nothing is stored.  */
+class counting_context : public format_context
+{
+public:
+  constexpr counting_context () noexcept
+    : format_context (m_scratch, sizeof (m_scratch), &recycle)
+  {
+  }
+
+private:
+  static constexpr void recycle (format_context& ctx, std::size_t)
+  {
+    auto& self = static_cast<counting_context&> (ctx);
+    self.set_window (self.m_scratch, sizeof (self.m_scratch));
+  }
+
+  char m_scratch[128];
+};
+
+/* Context writing through an arbitrary output iterator, staged in a
+   small local buffer that is flushed when full.  */
+template<typename OutputIt>
+class iterator_context : public format_context
+{
+public:
+  explicit iterator_context (OutputIt out)
+    : format_context (m_staging, sizeof (m_staging), &flush_staging),
+      m_out (std::move (out))
+  {
+  }
+
+  /* Flush staged bytes and return the advanced iterator.  */
+  OutputIt out () &&
+  {
+    flush ();
+    return std::move (m_out);
+  }
+
+private:
+  void flush ()
+  {
+    m_out = std::copy (m_staging, m_staging + m_size, std::move (m_out));
+    set_window (m_staging, sizeof (m_staging));
+  }
+
+  static void flush_staging (format_context& ctx, std::size_t)
+  {
+    static_cast<iterator_context&> (ctx).flush ();
+  }
+
+  char m_staging[256];
+  OutputIt m_out;
+};
+
+/* Result of format_to_n: the end of the stored output and the length
+   the untruncated output would have had.  */
+template<typename OutputIt>
+struct format_to_n_result
+{
+  OutputIt out;
+  std::size_t size;
+};
+
+/* Floating-point value with an explicit notation and precision.  A
+   negative precision selects the shortest round-trip representation
+   in that notation.  */
+template<std::floating_point T>
+struct float_format
+{
+  T value;
+  std::chars_format notation;
+  int precision;
+};
+
+/* Fixed notation: fixed(3.14159, 2) -> "3.14".  */
+template<std::floating_point T>
+constexpr float_format<T> fixed (T value, int precision = -1) noexcept
+{
+  return { value, std::chars_format::fixed, precision };
+}
+
+/* Scientific notation: scientific(1234.5, 2) -> "1.23e+03".  */
+template<std::floating_point T>
+constexpr float_format<T> scientific (T value, int precision = -1) noexcept
+{
+  return { value, std::chars_format::scientific, precision };
+}
+
+/* General notation with PRECISION significant digits, as printf's %g.  */
+template<std::floating_point T>
+constexpr float_format<T> general (T value, int precision = -1) noexcept
+{
+  return { value, std::chars_format::general, precision };
+}
+
+/* Bytes written as two hex digits each, for dumping buffers:
+   print_fmt("{}", hex_dump(std::as_bytes(std::span(packet)))).  */
+struct hex_dump_view
+{
+  std::span<const std::byte> bytes;
+  bool upper;
+};
+
+inline hex_dump_view hex_dump (std::span<const std::byte> bytes,
+                               bool upper = false) noexcept
+{
+  return { bytes, upper };
+}
+
+template<>
+struct formatter<hex_dump_view>
+{
+  void format (const hex_dump_view& view, format_context& ctx) const
+  {
+    ctx.append_hex (view.bytes.data (), view.bytes.size (), view.upper);
+  }
+
+  std::size_t size_hint (const hex_dump_view& view) const
+  {
+    return 2 * view.bytes.size ();
+  }
+};
+
+template<typename T>
+struct is_float_format : std::false_type {};
+
+template<typename T>
+struct is_float_format<float_format<T>> : std::true_type {};
+
+template<typename T>
+inline constexpr bool is_float_format_v = is_float_format<T>::value;
+
+namespace internal
+{
+  /* Characters of a floating-point value rendered with std::to_chars.
+     Plain values use the shortest round-trip form.  */
+  class float_chars
+  {
+  public:
+    template<std::floating_point T>
+    explicit float_chars (T value) noexcept
+    {
+      auto result = std::to_chars (m_data, m_data + sizeof (m_data), value);
+      m_size = result.ptr - m_data;
+    }
+
+    template<std::floating_point T>
+    explicit float_chars (const float_format<T>& value)
+    {
+      if (!render (m_data, sizeof (m_data), value))
+        {
+          /* Huge fixed-notation values or precisions.  */
+          std::size_t capacity = sizeof (m_data);
+          do
+            {
+              capacity *= 4;
+              m_overflow.resize (capacity);
+            }
+          while (!render (m_overflow.data (), capacity, value));
+        }
+    }
+
+    std::string_view view () const noexcept
+    {
+      return std::string_view (m_overflow.empty () ? m_data : m_overflow.data (),
+                               m_size);
+    }
+
+  private:
+    template<std::floating_point T>
+    bool render (char* first, std::size_t capacity, const float_format<T>& value)
+    {
+      std::to_chars_result result;
+      if (value.precision < 0)
+        {
+          result = std::to_chars (first, first + capacity,
+                                  value.value, value.notation);
+        }
+      else
+        {
+          result = std::to_chars (first, first + capacity,
+                                  value.value, value.notation, value.precision);
+        }
+      m_size = result.ptr - first;
+      return result.ec == std::errc ();
+    }
+
+    char m_data[64];
+    std::size_t m_size = 0;
+    std::string m_overflow;
+  };
+
+  /* String arguments a sink may reference instead of copying: character
+     arrays (literals) and string views, whose lifetime the caller
+     manages.  Owning strings are always copied, since they are often
+     temporaries that die before the output is written.  */
+  template<typename T>
+  inline constexpr bool borrowable_string
+    = (std::is_array_v<T>
+       && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>)
+      || std::is_same_v<T, std::string_view>;
+}
+
+/* Type tag of a stored format argument.  */
+enum class arg_type : unsigned char
+{
+  none,
+  boolean,
+  character,
+  int32,
+  uint32,
+  int64,
+  uint64,
+  float32,
+  float64,
+  long_double,
+  string,
+  custom
+};
+
+/* Non-owning reference to a single format argument.  Built-in types are
+   stored inline as tagged values, everything else as a pointer plus a
+   function-pointer thunk, so building one never allocates.  */
+class format_arg
+{
+public:
+  constexpr format_arg () noexcept
+    : m_custom {}, m_type (arg_type::none)
+  {
+  }
+
+  template<typename T>
+  explicit constexpr format_arg (const T& value) noexcept
   {
     if constexpr (std::is_same_v<T, bool>)
       {
-        return m_value ? 4 : 5; /* "true" or "false".  */
+        m_bool = value;
+        m_type = arg_type::boolean;
       }
-    else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>)
+    else if constexpr (std::is_same_v<T, char>)
       {
-        /* Max digits for integer: log10(2^bits) + sign.  */
-        if constexpr (std::is_signed_v<T>)
+        m_char = value;
+        m_type = arg_type::character;
+      }
+    else if constexpr (std::integral<T> && std::is_signed_v<T>)
+      {
+        if constexpr (sizeof (T) <= sizeof (int))
           {
-            return sizeof (T) * 3 + 2; /* Conservative estimate.  */
+            m_int = value;
+            m_type = arg_type::int32;
           }
         else
           {
-            return sizeof (T) * 3;
+            m_long_long = value;
+            m_type = arg_type::int64;
           }
       }
-    else if constexpr (std::is_same_v<T, char>)
+    else if constexpr (std::integral<T>)
       {
-        return 1;
+        if constexpr (sizeof (T) <= sizeof (unsigned))
+          {
+            m_uint = value;
+            m_type = arg_type::uint32;
+          }
+        else
+          {
+            m_ulong_long = value;
+            m_type = arg_type::uint64;
+          }
       }
-    else if constexpr (std::is_same_v<T, const char*>)
+    else if constexpr (std::is_same_v<T, float>)
       {
-        return std::strlen (m_value);
+        m_float = value;
+        m_type = arg_type::float32;
       }
-    else if constexpr (std::is_convertible_v<T, std::string_view>)
+    else if constexpr (std::is_same_v<T, double>)
+      {
+        m_double = value;
+        m_type = arg_type::float64;
+      }
+    else if constexpr (std::is_same_v<T, long double>)
+      {
+        m_long_double = value;
+        m_type = arg_type::long_double;
+      }
+    else if constexpr (std::is_convertible_v<T, std::string_view>
+                       && !has_formatter<T>)
       {
-        return std::string_view (m_value).size ();
+        std::string_view str (value);
+        m_string = { str.data (), str.size (),
+                     internal::borrowable_string<T> };
+        m_type = arg_type::string;
       }
     else
       {
-        return 32; /* Default estimate.  */
+        m_custom = { &value, &format_custom<T>, &custom_size_hint<T> };
+        m_type = arg_type::custom;
       }
   }
 
+  /* Write the argument to CTX.  */
+  constexpr void format (format_context& ctx) const;
+
+  /* Rough upper bound of the formatted length, used for reservation.  */
+  constexpr std::size_t estimated_size () const noexcept;
+
+  /* Write the argument to CTX according to SPEC.  */
+  constexpr void format (format_context& ctx, const format_spec& spec) const;
+
+  /* Exact formatted length.  Built-in types are measured arithmetically;
+     custom types are formatted once into a counting context.  */
+  constexpr std::size_t formatted_size () const;
+
+  /* Exact formatted length under SPEC.  */
+  constexpr std::size_t formatted_size (const format_spec& spec) const;
+
+  constexpr arg_type type () const noexcept
+  {
+    return m_type;
+  }
+
 private:
-  const T& m_value;
+  struct string_value
+  {
+    const char* data;
+    std::size_t size;
+    bool borrowable;
+  };
+
+  struct custom_value
+  {
+    const void* value;
+    void (*format) (format_context&, const void*);
+    std::size_t (*size_hint) (const void*);
+  };
+
+  template<typename T>
+  static void format_custom (format_context& ctx, const void* value)
+  {
+    internal::format_value_to (ctx, *static_cast<const T*> (value));
+  }
+
+  template<typename T>
+  static std::size_t custom_size_hint (const void* value)
+  {
+    if constexpr (requires { formatter<T> {}.size_hint (*static_cast<const T*> (value)); })
+      {
+        return formatter<T> {}.size_hint (*static_cast<const T*> (value));
+      }
+    else
+      {
+        return 32; /* Default estimate.  */
+      }
+  }
+
+  union
+  {
+    bool m_bool;
+    char m_char;
+    int m_int;
+    unsigned m_uint;
+    long long m_long_long;
+    unsigned long long m_ulong_long;
+    float m_float;
+    double m_double;
+    long double m_long_double;
+    string_value m_string;
+    custom_value m_custom;
+  };
+  arg_type m_type;
 };
 
-/* Optimized storage for format arguments - fixed-size array.  */
+/* Optimized storage for format arguments - fixed-size inline array.  */
 template<std::size_t MaxArgs = 16>
 class format_args
 {
 public:
   template<typename... Args>
-  format_args (const Args&... args)
-    : m_count (sizeof...(Args))
+  constexpr format_args (const Args&... args) noexcept
+    : m_args { format_arg (args)... },
+      m_count (sizeof...(Args))
   {
     static_assert (sizeof...(Args) <= MaxArgs,
                    "Too many format arguments");
-    std::size_t i = 0;
-    ((m_args[i++] = std::make_unique<format_arg<Args>> (args)), ...);
+  }
+
+  /* From already-built arguments.  */
+  explicit constexpr format_args (std::span<const format_arg> args) noexcept
+    : m_count (std::min (args.size (), MaxArgs))
+  {
+    std::copy_n (args.begin (), m_count, m_args.begin ());
   }
 
   /* Get argument by index.  */
-  const format_arg_base* get (std::size_t i) const noexcept
+  constexpr const format_arg* get (std::size_t i) const noexcept
   {
-    return i < m_count ? m_args[i].get () : nullptr;
+    return i < m_count ? &m_args[i] : nullptr;
   }
 
   /* Get number of arguments.  */
-  std::size_t size () const noexcept
+  constexpr std::size_t size () const noexcept
   {
     return m_count;
   }
 
+  /* Exact size of the first USED arguments.  */
+  constexpr std::size_t formatted_size (std::size_t used) const
+  {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < std::min (used, m_count); ++i)
+      {
+        total += m_args[i].formatted_size ();
+      }
+    return total;
+  }
+
   /* Estimate total size needed.  */
-  std::size_t estimate_total_size () const
+  constexpr std::size_t estimate_total_size () const noexcept
   {
     std::size_t total = 0;
     for (std::size_t i = 0; i < m_count; ++i)
       {
-        total += m_args[i]->estimated_size ();
+        total += m_args[i].estimated_size ();
       }
     return total;
   }
 
 private:
-  std::array<std::unique_ptr<format_arg_base>, MaxArgs> m_args;
+  std::array<format_arg, MaxArgs> m_args;
   std::size_t m_count;
 };
 
 /* Internal implementation with optimizations.  */
 namespace internal
 {
+  /* Formatted length of an integer, including the sign.  */
+  template<typename T>
+    requires std::integral<T>
+  constexpr std::size_t integer_size (T value) noexcept
+  {
+    using unsigned_type = std::make_unsigned_t<T>;
+    if constexpr (std::is_signed_v<T>)
+      {
+        if (value < 0)
+          {
+            return 1 + count_digits (unsigned_type (0) - static_cast<unsigned_type> (value));
+          }
+      }
+    return count_digits (static_cast<unsigned_type> (value));
+  }
+
   /* Fast integer to string conversion.  */
   template<typename T>
     requires (std::integral<T> && !std::is_same_v<T, bool>)
-  inline void format_integer (format_context& ctx, T value)
+  constexpr void format_integer (format_context& ctx, T value)
   {
-    char buffer[32];
-    auto [ptr, ec] = std::to_chars (buffer, buffer + sizeof (buffer), value);
-    ctx.append (std::string_view (buffer, ptr - buffer));
+    ctx.append_decimal (value);
   }
 
   /* Format single value to context - optimized.  */
   template<typename T>
-  void format_value_to (format_context& ctx, const T& value)
+  constexpr void format_value_to (format_context& ctx, const T& value)
   {
     if constexpr (std::is_same_v<T, bool>)
       {
@@ -203,6 +874,18 @@ namespace internal
       {
         ctx.push_back (value);
       }
+    else if constexpr (std::floating_point<T> || is_float_format_v<T>)
+      {
+        ctx.append (float_chars (value).view ());
+      }
+    else if constexpr (has_formatter<T>)
+      {
+        formatter<T> {}.format (value, ctx);
+      }
+    else if constexpr (borrowable_string<T>)
+      {
+        ctx.append_string (std::string_view (value));
+      }
     else if constexpr (std::is_convertible_v<T, std::string_view>)
       {
         ctx.append (std::string_view (value));
@@ -211,18 +894,240 @@ namespace internal
       {
         /* Fallback with small string optimization.  */
         thread_local std::ostringstream oss;
+        count_stat (io_stat::stream_fallbacks);
         oss.str ("");
         oss << value;
         ctx.append (oss.str ());
       }
   }
 
-  /* Parse format string and write formatted output - optimized.  */
-  template<std::size_t MaxArgs>
-  void vformat_to (format_context& ctx,
-                   std::string_view fmt,
-                   const format_args<MaxArgs>& args)
+  /* Write PREFIX and BODY padded to SPEC's width.  Zero padding goes
+     between the prefix (sign, radix marker) and the body.  */
+  constexpr void write_padded (format_context& ctx, const format_spec& spec,
+                            std::string_view prefix, std::string_view body,
+                            char default_align, bool numeric = false)
+  {
+    std::size_t length = prefix.size () + body.size ();
+    std::size_t padding = spec.width > length ? spec.width - length : 0;
+    std::size_t left = 0;
+
+    if (numeric && spec.zero_pad && spec.align == 0)
+      {
+        if (!prefix.empty ())
+          {
+            ctx.append (prefix);
+          }
+        ctx.append (padding, '0');
+        ctx.append (body);
+        return;
+      }
+
+    char align = spec.align ? spec.align : default_align;
+    if (align == '>')
+      {
+        left = padding;
+      }
+    else if (align == '^')
+      {
+        left = padding / 2;
+      }
+
+    ctx.append (left, spec.fill);
+    if (!prefix.empty ())
+      {
+        ctx.append (prefix);
+      }
+    ctx.append (body);
+    ctx.append (padding - left, spec.fill);
+  }
+
+  /* Sign character for a non-negative number under SPEC, or 0.  */
+  constexpr char positive_sign (const format_spec& spec) noexcept
+  {
+    return spec.sign == '+' || spec.sign == ' ' ? spec.sign : 0;
+  }
+
+  /* VALUE in BASE with lowercase digits, for constant evaluation where
+     std::to_chars is not constexpr yet.  */
+  template<typename U>
+  constexpr char* write_radix (char* out, U value, int base) noexcept
+  {
+    char* end = out;
+    do
+      {
+        *end++ = "0123456789abcdef"[value % base];
+        value /= base;
+      }
+    while (value != 0);
+    std::reverse (out, end);
+    return end;
+  }
+
+  /* Integer with width, sign, radix and prefix.  */
+  template<typename T>
+    requires std::integral<T>
+  constexpr void format_integer (format_context& ctx, T value,
+                                 const format_spec& spec)
+  {
+    using unsigned_type = std::make_unsigned_t<T>;
+
+    if (spec.type == 'c')
+      {
+        char ch = static_cast<char> (value);
+        write_padded (ctx, spec, {}, std::string_view (&ch, 1), '<');
+        return;
+      }
+
+    char prefix[4];
+    std::size_t prefix_size = 0;
+    unsigned_type magnitude = static_cast<unsigned_type> (value);
+    if (std::is_signed_v<T> && value < 0)
+      {
+        prefix[prefix_size++] = '-';
+        magnitude = unsigned_type (0) - magnitude;
+      }
+    else if (char sign = positive_sign (spec))
+      {
+        prefix[prefix_size++] = sign;
+      }
+
+    int base = 10;
+    switch (spec.type)
+      {
+      case 'b': case 'B': base = 2; break;
+      case 'o': base = 8; break;
+      case 'x': case 'X': base = 16; break;
+      case 0: case 'd': break;
+      default:
+        throw std::runtime_error ("Invalid format specifier for integer");
+      }
+    if (spec.alternate && base != 10)
+      {
+        prefix[prefix_size++] = '0';
+        if (base != 8)
+          {
+            prefix[prefix_size++] = spec.type;
+          }
+      }
+
+    char buffer[64];
+    char* ptr = base == 10 ? write_decimal (buffer, magnitude)
+                : std::is_constant_evaluated () ? write_radix (buffer, magnitude, base)
+                : std::to_chars (buffer, buffer + sizeof (buffer),
+                                 magnitude, base).ptr;
+    if (spec.type == 'X')
+      {
+        for (char* p = buffer; p != ptr; ++p)
+          {
+            if (*p >= 'a')
+              {
+                *p = static_cast<char> (*p - 'a' + 'A');
+              }
+          }
+      }
+    /* Octal alternate form needs no prefix when the value is zero.  */
+    if (base == 8 && spec.alternate && magnitude == 0)
+      {
+        --prefix_size;
+      }
+
+    write_padded (ctx, spec, std::string_view (prefix, prefix_size),
+                  std::string_view (buffer, ptr - buffer), '>', true);
+  }
+
+  /* Floating-point value with notation, precision and sign.  */
+  template<std::floating_point T>
+  void format_float (format_context& ctx, T value, const format_spec& spec)
+  {
+    std::chars_format notation = std::chars_format::general;
+    switch (spec.type)
+      {
+      case 'e': case 'E': notation = std::chars_format::scientific; break;
+      case 'f': case 'F': notation = std::chars_format::fixed; break;
+      case 'a': case 'A': notation = std::chars_format::hex; break;
+      case 0: case 'g': case 'G': break;
+      default:
+        throw std::runtime_error ("Invalid format specifier for floating point");
+      }
+
+    float_chars chars (spec.type == 0 && spec.precision < 0
+                       ? float_chars (value)
+                       : float_chars (float_format<T> { value, notation,
+                                                        spec.precision }));
+    std::string_view body = chars.view ();
+
+    char prefix[1];
+    std::size_t prefix_size = 0;
+    if (!body.empty () && body.front () == '-')
+      {
+        prefix[prefix_size++] = '-';
+        body.remove_prefix (1);
+      }
+    else if (char sign = positive_sign (spec))
+      {
+        prefix[prefix_size++] = sign;
+      }
+
+    std::string upper;
+    if (spec.type == 'E' || spec.type == 'F' || spec.type == 'G' || spec.type == 'A')
+      {
+        upper.assign (body);
+        for (char& ch : upper)
+          {
+            if (ch >= 'a' && ch <= 'z')
+              {
+                ch = static_cast<char> (ch - 'a' + 'A');
+              }
+          }
+        body = upper;
+      }
+
+    /* No zero padding for infinity and NaN.  */
+    bool finite = value == value && value - value == 0;
+    write_padded (ctx, spec, std::string_view (prefix, prefix_size), body,
+                  '>', finite);
+  }
+
+  /* String with width and precision (maximum length).  */
+  constexpr void format_string (format_context& ctx, std::string_view str,
+                             const format_spec& spec)
+  {
+    if (spec.type != 0 && spec.type != 's')
+      {
+        throw std::runtime_error ("Invalid format specifier for string");
+      }
+    if (spec.precision >= 0 && str.size () > std::size_t (spec.precision))
+      {
+        str = str.substr (0, spec.precision);
+      }
+    write_padded (ctx, spec, {}, str, '<');
+  }
+
+  /* Format single value to context according to SPEC.  */
+  template<typename T>
+  constexpr void format_value_to (format_context& ctx, const T& value,
+                                  const format_spec& spec);
+
+  /* Count one format string expansion that took CTX from START bytes
+     to its current size.  */
+  constexpr void count_format (const format_context& ctx, std::size_t start)
   {
+    if (!std::is_constant_evaluated ())
+      {
+        count_stat (io_stat::format_calls);
+        count_stat (io_stat::bytes_formatted, ctx.size () - start);
+      }
+  }
+
+  /* Parse format string and write formatted output - optimized.
+     Without SPECS every field is known to be plain, so its text is
+     skipped rather than parsed.  */
+  template<bool Specs, std::size_t MaxArgs>
+  constexpr void scan_format_to (format_context& ctx,
+                                 std::string_view fmt,
+                                 const format_args<MaxArgs>& args)
+  {
+    const std::size_t start = ctx.size ();
     std::size_t arg_index = 0;
     const char* pos = fmt.data ();
     const char* end = pos + fmt.size ();
@@ -259,11 +1164,8 @@ namespace internal
                 throw std::runtime_error ("Not enough arguments for format string");
               }
 
-            args.get (arg_index)->format (ctx);
-            ++arg_index;
-
             /* Find closing brace.  */
-            ++pos;
+            const char* field = ++pos;
             while (pos < end && *pos != '}')
               {
                 ++pos;
@@ -272,6 +1174,23 @@ namespace internal
               {
                 throw std::runtime_error ("Unclosed placeholder");
               }
+
+            if constexpr (Specs)
+              {
+                format_spec spec;
+                if (!parse_format_spec (std::string_view (field, pos - field),
+                                        spec))
+                  {
+                    throw std::runtime_error ("Invalid format specifier");
+                  }
+                args.get (arg_index)->format (ctx, spec);
+              }
+            else
+              {
+                args.get (arg_index)->format (ctx);
+              }
+            ++arg_index;
+
             ++pos;
             literal_start = pos;
           }
@@ -302,21 +1221,373 @@ namespace internal
       {
         ctx.append (std::string_view (literal_start, pos - literal_start));
       }
+    count_format (ctx, start);
+  }
+
+  template<std::size_t MaxArgs>
+  constexpr void vformat_to (format_context& ctx,
+                             std::string_view fmt,
+                             const format_args<MaxArgs>& args)
+  {
+    scan_format_to<true> (ctx, fmt, args);
+  }
+
+  /* A checked format string only needs its specs parsed if it has
+     any.  */
+  template<std::size_t MaxArgs>
+  constexpr void vformat_to (format_context& ctx,
+                             const compile_format_string& fmt,
+                             const format_args<MaxArgs>& args)
+  {
+    std::string_view text (fmt.data (), fmt.size ());
+    if (fmt.has_specs ())
+      {
+        scan_format_to<true> (ctx, text, args);
+      }
+    else
+      {
+        scan_format_to<false> (ctx, text, args);
+      }
+  }
+
+  /* Exact output length of FMT with ARGS.  Throws on too few
+     arguments, as formatting them would.  */
+  template<std::size_t MaxArgs>
+  constexpr std::size_t formatted_size (const compile_format_string& fmt,
+                                        const format_args<MaxArgs>& args)
+  {
+    if (fmt.arg_count () > args.size ())
+      {
+        throw std::runtime_error ("Not enough arguments for format string");
+      }
+    if (!fmt.has_specs ())
+      {
+        return fmt.literal_size () + args.formatted_size (fmt.arg_count ());
+      }
+    counting_context ctx;
+    vformat_to (ctx, fmt, args);
+    return ctx.size ();
+  }
+}
+
+constexpr void format_arg::format (format_context& ctx) const
+{
+  switch (m_type)
+    {
+    case arg_type::boolean:
+      ctx.append (m_bool ? "true" : "false");
+      break;
+    case arg_type::character:
+      ctx.push_back (m_char);
+      break;
+    case arg_type::int32:
+      internal::format_integer (ctx, m_int);
+      break;
+    case arg_type::uint32:
+      internal::format_integer (ctx, m_uint);
+      break;
+    case arg_type::int64:
+      internal::format_integer (ctx, m_long_long);
+      break;
+    case arg_type::uint64:
+      internal::format_integer (ctx, m_ulong_long);
+      break;
+    case arg_type::float32:
+      ctx.append (internal::float_chars (m_float).view ());
+      break;
+    case arg_type::float64:
+      ctx.append (internal::float_chars (m_double).view ());
+      break;
+    case arg_type::long_double:
+      ctx.append (internal::float_chars (m_long_double).view ());
+      break;
+    case arg_type::string:
+      if (m_string.borrowable)
+        {
+          ctx.append_string (std::string_view (m_string.data, m_string.size));
+        }
+      else
+        {
+          ctx.append (std::string_view (m_string.data, m_string.size));
+        }
+      break;
+    case arg_type::custom:
+      m_custom.format (ctx, m_custom.value);
+      break;
+    case arg_type::none:
+      break;
+    }
+}
+
+constexpr void format_arg::format (format_context& ctx,
+                                   const format_spec& spec) const
+{
+  if (spec.is_default ())
+    {
+      format (ctx);
+      return;
+    }
+
+  constexpr std::string_view integer_types = "bBcdoxX";
+  switch (m_type)
+    {
+    case arg_type::boolean:
+      if (spec.type != 0 && integer_types.find (spec.type) != std::string_view::npos)
+        {
+          internal::format_integer (ctx, unsigned (m_bool), spec);
+        }
+      else
+        {
+          internal::format_string (ctx, m_bool ? "true" : "false", spec);
+        }
+      break;
+    case arg_type::character:
+      if (spec.type != 0 && spec.type != 'c')
+        {
+          internal::format_integer (ctx, m_char, spec);
+        }
+      else
+        {
+          internal::write_padded (ctx, spec, {}, std::string_view (&m_char, 1), '<');
+        }
+      break;
+    case arg_type::int32:
+      internal::format_integer (ctx, m_int, spec);
+      break;
+    case arg_type::uint32:
+      internal::format_integer (ctx, m_uint, spec);
+      break;
+    case arg_type::int64:
+      internal::format_integer (ctx, m_long_long, spec);
+      break;
+    case arg_type::uint64:
+      internal::format_integer (ctx, m_ulong_long, spec);
+      break;
+    case arg_type::float32:
+      internal::format_float (ctx, m_float, spec);
+      break;
+    case arg_type::float64:
+      internal::format_float (ctx, m_double, spec);
+      break;
+    case arg_type::long_double:
+      internal::format_float (ctx, m_long_double, spec);
+      break;
+    case arg_type::string:
+      internal::format_string (ctx, std::string_view (m_string.data, m_string.size),
+                               spec);
+      break;
+    case arg_type::custom:
+      {
+        /* Only fill, alignment and width apply to other types.  The
+           value is measured first and then formatted in place between
+           the padding.  */
+        if (spec.sign != 0 || spec.alternate || spec.zero_pad
+            || spec.type != 0 || spec.precision >= 0)
+          {
+            throw std::runtime_error ("Invalid format specifier for custom type");
+          }
+        std::size_t padding = 0;
+        if (spec.width > 0)
+          {
+            counting_context counter;
+            m_custom.format (counter, m_custom.value);
+            padding = spec.width > counter.size () ? spec.width - counter.size () : 0;
+          }
+        std::size_t left = spec.align == '>' ? padding
+                           : spec.align == '^' ? padding / 2 : 0;
+        ctx.append (left, spec.fill);
+        m_custom.format (ctx, m_custom.value);
+        ctx.append (padding - left, spec.fill);
+      }
+      break;
+    case arg_type::none:
+      break;
+    }
+}
+
+constexpr std::size_t format_arg::formatted_size (const format_spec& spec) const
+{
+  if (spec.is_default ())
+    {
+      return formatted_size ();
+    }
+  counting_context ctx;
+  format (ctx, spec);
+  return ctx.size ();
+}
+
+constexpr std::size_t format_arg::estimated_size () const noexcept
+{
+  switch (m_type)
+    {
+    case arg_type::boolean:
+      return m_bool ? 4 : 5; /* "true" or "false".  */
+    case arg_type::character:
+      return 1;
+    /* Max digits for integer: log10(2^bits) + sign.  */
+    case arg_type::int32:
+      return sizeof (int) * 3 + 2;
+    case arg_type::uint32:
+      return sizeof (unsigned) * 3;
+    case arg_type::int64:
+      return sizeof (long long) * 3 + 2;
+    case arg_type::uint64:
+      return sizeof (unsigned long long) * 3;
+    /* Shortest round-trip forms such as "-1.7976931348623157e+308".  */
+    case arg_type::float32:
+      return 15;
+    case arg_type::float64:
+      return 24;
+    case arg_type::long_double:
+      return 32;
+    case arg_type::string:
+      return m_string.size;
+    case arg_type::custom:
+      return m_custom.size_hint (m_custom.value);
+    case arg_type::none:
+      break;
+    }
+  return 0;
+}
+
+constexpr std::size_t format_arg::formatted_size () const
+{
+  switch (m_type)
+    {
+    case arg_type::boolean:
+      return m_bool ? 4 : 5;
+    case arg_type::character:
+      return 1;
+    case arg_type::int32:
+      return internal::integer_size (m_int);
+    case arg_type::uint32:
+      return internal::integer_size (m_uint);
+    case arg_type::int64:
+      return internal::integer_size (m_long_long);
+    case arg_type::uint64:
+      return internal::integer_size (m_ulong_long);
+    case arg_type::float32:
+      return internal::float_chars (m_float).view ().size ();
+    case arg_type::float64:
+      return internal::float_chars (m_double).view ().size ();
+    case arg_type::long_double:
+      return internal::float_chars (m_long_double).view ().size ();
+    case arg_type::string:
+      return m_string.size;
+    case arg_type::custom:
+      {
+        counting_context ctx;
+        m_custom.format (ctx, m_custom.value);
+        return ctx.size ();
+      }
+    case arg_type::none:
+      break;
+    }
+  return 0;
+}
+
+namespace internal
+{
+  template<typename T>
+  constexpr void format_value_to (format_context& ctx, const T& value,
+                                  const format_spec& spec)
+  {
+    format_arg (value).format (ctx, spec);
   }
 }
 
-/* Main formatting function with capacity estimation.  */
+/* Exact length of format (FMT, ARGS...), computed without formatting
+   built-in arguments.  */
+template<typename... Args>
+constexpr std::size_t formatted_size (compile_format_string fmt,
+                                      const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  return internal::formatted_size (fmt, fargs);
+}
+
+/* Formatting function that sizes the output exactly first, so the
+   result string is allocated once and never grows.  */
+template<typename... Args>
+std::string format_exact (compile_format_string fmt, const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  format_context ctx (internal::formatted_size (fmt, fargs));
+
+  internal::vformat_to (ctx, fmt, fargs);
+  return std::move (ctx).str ();
+}
+
+/* Main formatting function with capacity estimation.  Defining
+   FASTIO_EXACT_SIZING switches it to exact two-pass sizing.  */
 template<typename... Args>
 std::string format (compile_format_string fmt, const Args&... args)
 {
+#ifdef FASTIO_EXACT_SIZING
+  return format_exact (fmt, args...);
+#else
   format_args<sizeof...(Args)> fargs (args...);
   
   /* Estimate required capacity.  */
   std::size_t estimated_size = fmt.size () + fargs.estimate_total_size ();
   format_context ctx (estimated_size);
   
-  internal::vformat_to (ctx, std::string_view (fmt.data (), fmt.size ()), fargs);
+  internal::vformat_to (ctx, fmt, fargs);
+  if (ctx.size () > estimated_size) [[unlikely]]
+    {
+      internal::count_stat (io_stat::estimate_misses);
+    }
   return std::move (ctx).str ();
+#endif
+}
+
+/* Format into a caller-provided buffer that is assumed large enough.
+   Returns the end of the written output.  */
+template<typename... Args>
+constexpr char* format_to (char* out, compile_format_string fmt,
+                           const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  fixed_buffer_context ctx (out, std::numeric_limits<std::size_t>::max () / 2);
+
+  internal::vformat_to (ctx, fmt, fargs);
+  return out + ctx.size ();
+}
+
+/* Format through an output iterator without building a string.  */
+template<typename OutputIt, typename... Args>
+  requires std::output_iterator<OutputIt, char>
+OutputIt format_to (OutputIt out, compile_format_string fmt, const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  iterator_context<OutputIt> ctx (std::move (out));
+
+  internal::vformat_to (ctx, fmt, fargs);
+  return std::move (ctx).out ();
+}
+
+/* Format into an existing context, e.g. from a formatter
+   specialization.  */
+template<typename... Args>
+constexpr void format_to (format_context& ctx, compile_format_string fmt,
+                          const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  internal::vformat_to (ctx, fmt, fargs);
+}
+
+/* Format at most N bytes into OUT.  The result's size is the full
+   untruncated length, so size > N reports truncation.  */
+template<typename... Args>
+constexpr format_to_n_result<char*> format_to_n (char* out, std::size_t n,
+                                                 compile_format_string fmt,
+                                                 const Args&... args)
+{
+  format_args<sizeof...(Args)> fargs (args...);
+  fixed_buffer_context ctx (out, n);
+
+  internal::vformat_to (ctx, fmt, fargs);
+  return { out + ctx.stored (), ctx.size () };
 }
 
 } /* namespace fastio */
@@ -0,0 +1,147 @@
+/* hex.hpp - Bulk hexadecimal encoding for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_HEX_HPP
+#define FASTIO_HEX_HPP
+
+#include "scan.hpp"
+#include <cstddef>
+
+/* Kernels turning N bytes into 2 * N hex digits, two per byte, high
+   nibble first.  The vector ones look each nibble up in a 16-byte
+   digit table with PSHUFB and interleave the high and low digits;
+   SSSE3 and AVX2 are both chosen at run time.  */
+
+namespace fastio {
+
+namespace internal
+{
+  inline constexpr char hex_digits_lower[] = "0123456789abcdef";
+  inline constexpr char hex_digits_upper[] = "0123456789ABCDEF";
+
+  namespace scalar
+  {
+    inline char* encode_hex (char* out, const std::byte* in, std::size_t n,
+                             const char* digits) noexcept
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        {
+          unsigned byte = static_cast<unsigned char> (in[i]);
+          out[0] = digits[byte >> 4];
+          out[1] = digits[byte & 15];
+          out += 2;
+        }
+      return out;
+    }
+  }
+
+#ifdef FASTIO_X86_SIMD
+  namespace ssse3
+  {
+    /* 16 bytes of IN to 32 digits at OUT.  */
+    __attribute__ ((target ("ssse3")))
+    inline void encode_hex_block (char* out, const std::byte* in,
+                                  __m128i table) noexcept
+    {
+      __m128i v = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (in));
+      __m128i nibble = _mm_set1_epi8 (15);
+      __m128i high = _mm_shuffle_epi8 (
+        table, _mm_and_si128 (_mm_srli_epi16 (v, 4), nibble));
+      __m128i low = _mm_shuffle_epi8 (table, _mm_and_si128 (v, nibble));
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (out),
+                        _mm_unpacklo_epi8 (high, low));
+      _mm_storeu_si128 (reinterpret_cast<__m128i*> (out + 16),
+                        _mm_unpackhi_epi8 (high, low));
+    }
+
+    __attribute__ ((target ("ssse3")))
+    inline char* encode_hex (char* out, const std::byte* in, std::size_t n,
+                             const char* digits) noexcept
+    {
+      __m128i table = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (digits));
+      for (; n >= 16; n -= 16, in += 16, out += 32)
+        {
+          encode_hex_block (out, in, table);
+        }
+      return scalar::encode_hex (out, in, n, digits);
+    }
+  }
+
+  namespace avx2
+  {
+    /* The byte unpacks work within each 128-bit lane, so the halves
+       come out as [0-7 | 16-23] and [8-15 | 24-31] and are put back
+       in order with a cross-lane permute.  */
+    __attribute__ ((target ("avx2")))
+    inline char* encode_hex (char* out, const std::byte* in, std::size_t n,
+                             const char* digits) noexcept
+    {
+      __m256i table = _mm256_broadcastsi128_si256 (
+        _mm_loadu_si128 (reinterpret_cast<const __m128i*> (digits)));
+      __m256i nibble = _mm256_set1_epi8 (15);
+      for (; n >= 32; n -= 32, in += 32, out += 64)
+        {
+          __m256i v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (in));
+          __m256i high = _mm256_shuffle_epi8 (
+            table, _mm256_and_si256 (_mm256_srli_epi16 (v, 4), nibble));
+          __m256i low = _mm256_shuffle_epi8 (table, _mm256_and_si256 (v, nibble));
+          __m256i first = _mm256_unpacklo_epi8 (high, low);
+          __m256i second = _mm256_unpackhi_epi8 (high, low);
+          _mm256_storeu_si256 (reinterpret_cast<__m256i*> (out),
+                               _mm256_permute2x128_si256 (first, second, 0x20));
+          _mm256_storeu_si256 (reinterpret_cast<__m256i*> (out + 32),
+                               _mm256_permute2x128_si256 (first, second, 0x31));
+        }
+      return ssse3::encode_hex (out, in, n, digits);
+    }
+  }
+
+  /* Checked once per process.  */
+  inline bool cpu_has_ssse3 () noexcept
+  {
+    static const bool has_ssse3 = __builtin_cpu_supports ("ssse3");
+    return has_ssse3;
+  }
+#endif
+
+  /* Write the N bytes at IN as 2 * N hex digits at OUT; returns the end
+     of the digits.  */
+  inline char* encode_hex (char* out, const std::byte* in, std::size_t n,
+                           bool upper = false) noexcept
+  {
+    const char* digits = upper ? hex_digits_upper : hex_digits_lower;
+#ifdef FASTIO_X86_SIMD
+    if (n >= 16)
+      {
+        if (cpu_has_avx2 ())
+          {
+            return avx2::encode_hex (out, in, n, digits);
+          }
+        if (cpu_has_ssse3 ())
+          {
+            return ssse3::encode_hex (out, in, n, digits);
+          }
+      }
+#endif
+    return scalar::encode_hex (out, in, n, digits);
+  }
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_HEX_HPP */
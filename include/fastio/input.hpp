@@ -19,32 +19,478 @@
 #ifndef FASTIO_INPUT_HPP
 #define FASTIO_INPUT_HPP
 
+#include "parse.hpp"
+#include "scan.hpp"
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
 
 namespace fastio {
 
 /* Internal implementation details.  */
 namespace internal
 {
-  /* Read single value from stream.  */
+  /* Character types are read as single characters, like operator>>.  */
   template<typename T>
-  void
-  input_one (std::istream& is, T& value)
+  concept input_char = std::is_same_v<T, char>
+                       || std::is_same_v<T, signed char>
+                       || std::is_same_v<T, unsigned char>;
+
+  /* Parse the whole of TOKEN as a number; a leading '+' is accepted
+     as it is by operator>>.  */
+  template<typename T>
+  inline bool parse_token (std::string_view token, T& value)
+  {
+    const char* first = token.data ();
+    const char* last = first + token.size ();
+    if (first != last && *first == '+')
+      {
+        ++first;
+        if (first != last && *first == '-')
+          {
+            return false;
+          }
+      }
+    std::from_chars_result result;
+    if constexpr (std::integral<T>)
+      {
+        result = parse_integer (first, last, value);
+      }
+    else
+      {
+        result = std::from_chars (first, last, value);
+      }
+    return result.ec == std::errc () && result.ptr == last && first != last;
+  }
+
+  /* Convert a whole non-empty token to VALUE; throws std::runtime_error
+     when it is not a valid T.  */
+  template<typename T>
+  inline void parse_value (std::string_view token, T& value)
   {
     if constexpr (std::is_same_v<T, std::string>)
       {
-        /* Special handling for strings: skip whitespace.  */
-        is >> std::ws;
-        std::getline (is, value, ' ');
+        value.assign (token);
+      }
+    else if constexpr (std::is_same_v<T, bool>)
+      {
+        if (token != "0" && token != "1")
+          {
+            throw std::runtime_error ("Failed to parse bool");
+          }
+        value = token[0] == '1';
+      }
+    else if constexpr (std::integral<T>)
+      {
+        if (!parse_token (token, value))
+          {
+            throw std::runtime_error ("Failed to parse integer");
+          }
+      }
+    else if constexpr (std::floating_point<T>)
+      {
+        if (!parse_token (token, value))
+          {
+            throw std::runtime_error ("Failed to parse floating point");
+          }
+      }
+    else
+      {
+        /* Any other type is read from the token with its operator>>,
+           as input () always did.  */
+        std::istringstream in {std::string (token)};
+        if (!(in >> value))
+          {
+            throw std::runtime_error ("Failed to parse value");
+          }
+      }
+  }
+
+  /* Line view of [FIRST, LAST) without a trailing '\r'.  */
+  inline std::string_view chomp (const char* first, const char* last) noexcept
+  {
+    if (last != first && last[-1] == '\r')
+      {
+        --last;
+      }
+    return std::string_view (first, last - first);
+  }
+}
+
+/* Buffered scanner on a raw file descriptor.  Input is pulled with
+   read(2) in large blocks and numbers are parsed in place with
+   std::from_chars, bypassing iostream sentries, locales and stdio
+   sync.  Tokens are separated by any whitespace.  */
+class fd_reader
+{
+public:
+  static constexpr std::size_t default_capacity = 64 * 1024;
+
+  explicit fd_reader (int fd, std::size_t capacity = default_capacity)
+    : m_fd (fd),
+      m_buffer (new char[capacity ? capacity : 1]),
+      m_capacity (capacity ? capacity : 1)
+  {
+  }
+
+  fd_reader (const fd_reader&) = delete;
+  fd_reader& operator= (const fd_reader&) = delete;
+
+  /* Next whitespace-delimited token, or an empty view at end of input.
+     The view stays valid until the next call on this reader.  */
+  std::string_view token ()
+  {
+    if (!skip_whitespace ())
+      {
+        return {};
+      }
+    std::size_t end = m_pos;
+    for (;;)
+      {
+        end = m_spaces.find<true> (m_buffer.get () + end,
+                                   m_buffer.get () + m_end) - m_buffer.get ();
+        if (end < m_end || !refill_keep (end))
+          {
+            break;
+          }
+      }
+    std::string_view result (m_buffer.get () + m_pos, end - m_pos);
+    m_pos = end;
+    return result;
+  }
+
+  /* Rest of the current line without its terminator ("\n" or "\r\n").
+     Returns false only at end of input.  */
+  bool line (std::string_view& result)
+  {
+    if (m_pos == m_end && !refill ())
+      {
+        return false;
+      }
+    std::size_t end = m_pos;
+    for (;;)
+      {
+        end = internal::find_newline (m_buffer.get () + end,
+                                      m_buffer.get () + m_end) - m_buffer.get ();
+        if (end < m_end || !refill_keep (end))
+          {
+            break;
+          }
+      }
+    result = internal::chomp (m_buffer.get () + m_pos, m_buffer.get () + end);
+    m_pos = end < m_end ? end + 1 : end;
+    return true;
+  }
+
+  /* Read one value.  Returns false at end of input; throws
+     std::runtime_error when the next token is not a valid T.  */
+  template<typename T>
+  bool read (T& value)
+  {
+    if constexpr (internal::input_char<T>)
+      {
+        if (!skip_whitespace ())
+          {
+            return false;
+          }
+        value = static_cast<T> (m_buffer[m_pos++]);
+        return true;
       }
     else
       {
-        /* Use standard stream input.  */
-        is >> value;
+        std::string_view tok = token ();
+        if (tok.empty ())
+          {
+            return false;
+          }
+        internal::parse_value (tok, value);
+        return true;
       }
   }
 
+  /* Read several values in order; false if input ended before all
+     of them were read.  */
+  template<typename... Args>
+    requires (sizeof...(Args) > 1)
+  bool read (Args&... args)
+  {
+    return (read (args) && ...);
+  }
+
+  /* True once every byte of input has been consumed.  */
+  bool eof ()
+  {
+    return m_pos == m_end && !refill ();
+  }
+
+  int fd () const noexcept { return m_fd; }
+
+private:
+  /* Advance to the next non-space byte; false at end of input.  */
+  bool skip_whitespace ()
+  {
+    for (;;)
+      {
+        m_pos = m_spaces.find<false> (m_buffer.get () + m_pos,
+                                      m_buffer.get () + m_end)
+                - m_buffer.get ();
+        if (m_pos < m_end)
+          {
+            return true;
+          }
+        if (!refill ())
+          {
+            return false;
+          }
+      }
+  }
+
+  /* Replace the consumed buffer with fresh input.  */
+  bool refill ()
+  {
+    m_pos = 0;
+    m_end = 0;
+    m_spaces.reset ();
+    return fill ();
+  }
+
+  /* Read more input while keeping [m_pos, m_end) in the buffer; CURSOR
+     is an offset into that range and is rebased along with it.  The
+     buffer doubles when a single token or line fills it.  */
+  bool refill_keep (std::size_t& cursor)
+  {
+    std::size_t kept = m_end - m_pos;
+    if (kept == m_capacity)
+      {
+        std::unique_ptr<char[]> larger (new char[m_capacity * 2]);
+        std::memcpy (larger.get (), m_buffer.get (), m_capacity);
+        m_buffer = std::move (larger);
+        m_capacity *= 2;
+      }
+    else if (m_pos > 0)
+      {
+        std::memmove (m_buffer.get (), m_buffer.get () + m_pos, kept);
+      }
+    cursor -= m_pos;
+    m_pos = 0;
+    m_end = kept;
+    m_spaces.reset ();
+    return fill ();
+  }
+
+  /* Append one read(2) worth of input after m_end.  */
+  bool fill ()
+  {
+    if (m_eof)
+      {
+        return false;
+      }
+    for (;;)
+      {
+        ssize_t n = ::read (m_fd, m_buffer.get () + m_end, m_capacity - m_end);
+        if (n < 0)
+          {
+            if (errno == EINTR)
+              {
+                continue;
+              }
+            throw std::system_error (errno, std::generic_category (),
+                                     "fastio: read failed");
+          }
+        if (n == 0)
+          {
+            m_eof = true;
+            return false;
+          }
+        m_end += static_cast<std::size_t> (n);
+        return true;
+      }
+  }
+
+  int m_fd;
+  std::unique_ptr<char[]> m_buffer;
+  std::size_t m_capacity;
+  std::size_t m_pos = 0;
+  std::size_t m_end = 0;
+  bool m_eof = false;
+  internal::space_index m_spaces;
+};
+
+/* Scanner over text already in memory.  Line and token views point
+   into the text itself.  */
+class string_reader
+{
+public:
+  explicit string_reader (std::string_view text = {}) noexcept
+    : m_pos (text.data ()), m_end (text.data () + text.size ())
+  {
+  }
+
+  /* Next whitespace-delimited token, or an empty view at end of input.  */
+  std::string_view token () noexcept
+  {
+    const char* first = m_spaces.find<false> (m_pos, m_end);
+    m_pos = m_spaces.find<true> (first, m_end);
+    return std::string_view (first, m_pos - first);
+  }
+
+  /* Rest of the current line without its terminator.  Returns false
+     only at end of input.  */
+  bool line (std::string_view& result) noexcept
+  {
+    if (m_pos == m_end)
+      {
+        return false;
+      }
+    const char* end = internal::find_newline (m_pos, m_end);
+    result = internal::chomp (m_pos, end);
+    m_pos = end == m_end ? end : end + 1;
+    return true;
+  }
+
+  /* Read one value, as fd_reader::read does.  */
+  template<typename T>
+  bool read (T& value)
+  {
+    if constexpr (internal::input_char<T>)
+      {
+        m_pos = m_spaces.find<false> (m_pos, m_end);
+        if (m_pos == m_end)
+          {
+            return false;
+          }
+        value = static_cast<T> (*m_pos++);
+        return true;
+      }
+    else
+      {
+        std::string_view tok = token ();
+        if (tok.empty ())
+          {
+            return false;
+          }
+        internal::parse_value (tok, value);
+        return true;
+      }
+  }
+
+  template<typename... Args>
+    requires (sizeof...(Args) > 1)
+  bool read (Args&... args)
+  {
+    return (read (args) && ...);
+  }
+
+  bool eof () const noexcept { return m_pos == m_end; }
+
+  /* Input not consumed yet.  */
+  std::string_view rest () const noexcept
+  {
+    return std::string_view (m_pos, m_end - m_pos);
+  }
+
+private:
+  const char* m_pos;
+  const char* m_end;
+  internal::space_index m_spaces;
+};
+
+/* Buffered scanner for standard input.  */
+inline fd_reader& in ()
+{
+  static fd_reader reader (STDIN_FILENO);
+  return reader;
+}
+
+/* Single-pass range over the lines or tokens of a reader (fd_reader,
+   mapped_file).  Each view stays valid as long as the reader keeps it:
+   until the next step for fd_reader.  */
+template<typename Reader, bool Lines>
+class view_range
+{
+public:
+  class iterator
+  {
+  public:
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+
+    iterator () = default;
+    explicit iterator (Reader& reader) : m_reader (&reader) { ++*this; }
+
+    std::string_view operator* () const noexcept { return m_current; }
+
+    iterator& operator++ ()
+    {
+      if constexpr (Lines)
+        {
+          m_done = !m_reader->line (m_current);
+        }
+      else
+        {
+          m_current = m_reader->token ();
+          m_done = m_current.empty ();
+        }
+      return *this;
+    }
+
+    void operator++ (int) { ++*this; }
+
+    bool operator== (std::default_sentinel_t) const noexcept { return m_done; }
+
+  private:
+    Reader* m_reader = nullptr;
+    std::string_view m_current;
+    bool m_done = true;
+  };
+
+  explicit view_range (Reader& reader) noexcept : m_reader (reader) {}
+
+  iterator begin () { return iterator (m_reader); }
+  std::default_sentinel_t end () const noexcept { return {}; }
+
+private:
+  Reader& m_reader;
+};
+
+/* for (std::string_view line : fastio::lines (reader)) ...  */
+template<typename Reader>
+view_range<Reader, true> lines (Reader& reader)
+{
+  return view_range<Reader, true> (reader);
+}
+
+/* for (std::string_view token : fastio::tokens (reader)) ...  */
+template<typename Reader>
+view_range<Reader, false> tokens (Reader& reader)
+{
+  return view_range<Reader, false> (reader);
+}
+
+/* Internal implementation details.  */
+namespace internal
+{
+  /* Read single value from stream.  */
+  template<typename T>
+  void
+  input_one (std::istream& is, T& value)
+  {
+    /* operator>> splits strings on any whitespace, not only ' '.  */
+    is >> value;
+  }
+
   /* Recursive input implementation.  */
   template<typename First, typename... Rest>
   void
@@ -58,39 +504,64 @@ namespace internal
   }
 }
 
-/* Read single value from stdin.  */
-template<typename T>
-void
-input (T& value)
-{
-  internal::input_one (std::cin, value);
-}
-
-/* Read multiple values from stdin.  */
+/* Read values from stdin.  By default this goes through fastio::in ();
+   define FASTIO_USE_STREAM_INPUT to read from std::cin instead, e.g.
+   when the program also reads std::cin directly.  Returns false if
+   input ended first.  */
 template<typename... Args>
-void
+bool
 input (Args&... args)
 {
+#ifdef FASTIO_USE_STREAM_INPUT
   internal::input_impl (std::cin, args...);
+  return static_cast<bool> (std::cin);
+#else
+  return (in ().read (args) && ...);
+#endif
 }
 
 /* Read from arbitrary input stream.  */
 template<typename... Args>
-void
+bool
 finput (std::istream& is, Args&... args)
 {
   internal::input_impl (is, args...);
+  return static_cast<bool> (is);
+}
+
+/* Readers finput () accepts besides std::istream: fd_reader,
+   mapped_file and anything else yielding tokens and lines.  */
+template<typename Reader>
+concept token_reader = requires (Reader& reader, std::string_view& line)
+{
+  { reader.token () } -> std::same_as<std::string_view>;
+  { reader.line (line) } -> std::same_as<bool>;
+  { reader.eof () } -> std::same_as<bool>;
+};
+
+/* Read from a token reader.  */
+template<token_reader Reader, typename... Args>
+bool
+finput (Reader& reader, Args&... args)
+{
+  return (reader.read (args) && ...);
 }
 
 /* Read line from stdin.  */
 inline std::string
 readline ()
 {
+#ifdef FASTIO_USE_STREAM_INPUT
   std::string line;
   std::getline (std::cin, line);
   return line;
+#else
+  std::string_view line;
+  in ().line (line);
+  return std::string (line);
+#endif
 }
 
 } /* namespace fastio */
 
-#endif /* FASTIO_INPUT_HPP */
\ No newline at end of file
+#endif /* FASTIO_INPUT_HPP */
@@ -0,0 +1,166 @@
+/* mapped_file.hpp - Memory-mapped file input for FastIO.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_MAPPED_FILE_HPP
+#define FASTIO_MAPPED_FILE_HPP
+
+#include "input.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fastio {
+
+/* Zero-copy reader over a whole file.  Regular files are mapped with
+   mmap(2) and read sequentially; line and token views point straight
+   into the mapping and stay valid for the reader's lifetime.  Pipes,
+   terminals and other unmappable inputs fall back to an fd_reader, in
+   which case a view lasts only until the next call.  */
+class mapped_file
+{
+public:
+  /* Open and map PATH; throws std::system_error if it cannot be
+     opened.  */
+  explicit mapped_file (const std::string& path)
+    : m_fd (::open (path.c_str (), O_RDONLY | O_CLOEXEC)),
+      m_owns_fd (true)
+  {
+    if (m_fd < 0)
+      {
+        throw std::system_error (errno, std::generic_category (),
+                                 "fastio: cannot open " + path);
+      }
+    attach ();
+  }
+
+  /* Read FD, e.g. STDIN_FILENO, without taking ownership of it.  */
+  explicit mapped_file (int fd)
+    : m_fd (fd),
+      m_owns_fd (false)
+  {
+    attach ();
+  }
+
+  mapped_file (const mapped_file&) = delete;
+  mapped_file& operator= (const mapped_file&) = delete;
+
+  ~mapped_file ()
+  {
+    if (m_map != nullptr)
+      {
+        ::munmap (m_map, m_size);
+      }
+    if (m_owns_fd)
+      {
+        ::close (m_fd);
+      }
+  }
+
+  /* True if the input is memory mapped rather than read in blocks.  */
+  bool mapped () const noexcept { return m_stream == nullptr; }
+
+  /* The whole mapped input; empty when not mapped.  */
+  std::string_view data () const noexcept
+  {
+    return mapped () ? m_data : std::string_view ();
+  }
+
+  /* Next whitespace-delimited token, or an empty view at end of input.  */
+  std::string_view token ()
+  {
+    return m_stream ? m_stream->token () : m_view.token ();
+  }
+
+  /* Rest of the current line without its terminator.  Returns false
+     only at end of input.  */
+  bool line (std::string_view& result)
+  {
+    return m_stream ? m_stream->line (result) : m_view.line (result);
+  }
+
+  /* Read one value, as fd_reader::read does.  */
+  template<typename T>
+  bool read (T& value)
+  {
+    return m_stream ? m_stream->read (value) : m_view.read (value);
+  }
+
+  template<typename... Args>
+    requires (sizeof...(Args) > 1)
+  bool read (Args&... args)
+  {
+    return (read (args) && ...);
+  }
+
+  /* True once every byte of input has been consumed.  */
+  bool eof ()
+  {
+    return m_stream ? m_stream->eof () : m_view.eof ();
+  }
+
+private:
+  /* Map regular files from the current file offset on.  Anything else
+     is read through an fd_reader: pipes, terminals, a failed mapping,
+     and empty files, since /proc and sysfs report size 0 for files
+     that do have content.  */
+  void attach ()
+  {
+    struct stat st;
+    if (::fstat (m_fd, &st) == 0 && S_ISREG (st.st_mode) && st.st_size > 0)
+      {
+        off_t offset = ::lseek (m_fd, 0, SEEK_CUR);
+        std::size_t size = static_cast<std::size_t> (st.st_size);
+        void* map = ::mmap (nullptr, size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (map != MAP_FAILED)
+          {
+            ::madvise (map, size, MADV_SEQUENTIAL);
+            m_map = map;
+            m_size = size;
+            std::size_t skip = std::min<std::size_t> (offset > 0 ? offset : 0,
+                                                      size);
+            m_data = std::string_view (static_cast<const char*> (map) + skip,
+                                       size - skip);
+            m_view = string_reader (m_data);
+            return;
+          }
+      }
+    m_stream = std::make_unique<fd_reader> (m_fd);
+  }
+
+  int m_fd;
+  bool m_owns_fd;
+  void* m_map = nullptr;
+  std::size_t m_size = 0;
+  std::string_view m_data;
+  string_reader m_view;
+  /* Fallback reader, only for input that is not mapped.  Held by
+     pointer rather than std::optional, which trips GCC's
+     -Wmaybe-uninitialized on the reader's buffer in Release builds.  */
+  std::unique_ptr<fd_reader> m_stream;
+};
+
+} /* namespace fastio */
+
+#endif /* FASTIO_MAPPED_FILE_HPP */
@@ -0,0 +1,584 @@
+/* output.hpp - Buffered raw file descriptor output for FastIO.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_OUTPUT_HPP
+#define FASTIO_OUTPUT_HPP
+
+#include "format.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace fastio {
+
+/* When an fd_writer hands its buffer to the kernel.  */
+enum class flush_policy
+{
+  on_newline,  /* After every write that contains a newline.  */
+  on_size,     /* Only when the buffer is full.  */
+  manual,      /* When full or on an explicit flush () call.  */
+  whole_lines  /* When full, writing only complete lines and keeping a
+                  trailing partial line buffered, so with a buffer of at
+                  most PIPE_BUF bytes every write(2) is atomic and no
+                  line is torn by other writers.  */
+};
+
+/* Buffered writer on a raw file descriptor.  Output is collected in a
+   user-space buffer and handed to write(2) according to the flush
+   policy, bypassing iostream sentries, locales and stdio sync.  */
+class fd_writer
+{
+public:
+  class context;
+
+  static constexpr std::size_t default_capacity = 64 * 1024;
+
+  explicit fd_writer (int fd,
+                      flush_policy policy = flush_policy::on_size,
+                      std::size_t capacity = default_capacity,
+                      bool flush_at_exit = true)
+    : m_fd (fd),
+      m_policy (policy),
+      m_flush_at_exit (flush_at_exit),
+      m_buffer (new char[capacity ? capacity : 1]),
+      m_capacity (capacity ? capacity : 1)
+  {
+  }
+
+  fd_writer (const fd_writer&) = delete;
+  fd_writer& operator= (const fd_writer&) = delete;
+
+  /* Unless constructed otherwise, pending output is flushed when the
+     writer is destroyed, whatever the policy; the global writers are
+     destroyed at exit.  */
+  ~fd_writer ()
+  {
+    if (m_flush_at_exit)
+      {
+        try
+          {
+            flush ();
+          }
+        catch (...)
+          {
+          }
+      }
+  }
+
+  /* Append DATA; payloads larger than the buffer bypass it.  */
+  void write (std::string_view data)
+  {
+    if (data.size () > m_capacity - m_size)
+      {
+        make_room ();
+      }
+    if (data.size () > m_capacity - m_size)
+      {
+        flush ();
+        if (data.size () >= m_capacity)
+          {
+            write_all (data.data (), data.size ());
+            return;
+          }
+      }
+    std::memcpy (m_buffer.get () + m_size, data.data (), data.size ());
+    m_size += data.size ();
+    after_write (data.data (), data.size ());
+  }
+
+  void put (char ch)
+  {
+    if (m_size == m_capacity)
+      {
+        make_room ();
+      }
+    m_buffer[m_size++] = ch;
+    after_write (&ch, 1);
+  }
+
+  /* Write out everything buffered so far.  */
+  void flush ()
+  {
+    if (m_size > 0)
+      {
+        std::size_t size = m_size;
+        m_size = 0;
+        m_drained += size;
+        write_all (m_buffer.get (), size);
+      }
+  }
+
+  void set_policy (flush_policy policy) noexcept { m_policy = policy; }
+  flush_policy policy () const noexcept { return m_policy; }
+  int fd () const noexcept { return m_fd; }
+  std::size_t buffered () const noexcept { return m_size; }
+
+private:
+  /* Free space in a full buffer: under whole_lines write out the
+     complete lines and keep the partial one, otherwise write it all.  */
+  void make_room ()
+  {
+    if (m_policy == flush_policy::whole_lines)
+      {
+        const void* newline = ::memrchr (m_buffer.get (), '\n', m_size);
+        if (newline != nullptr)
+          {
+            std::size_t lines = static_cast<const char*> (newline) + 1
+                                - m_buffer.get ();
+            std::size_t rest = m_size - lines;
+            m_size = rest;
+            m_drained += lines;
+            write_all (m_buffer.get (), lines);
+            std::memmove (m_buffer.get (), m_buffer.get () + lines, rest);
+            return;
+          }
+      }
+    flush ();
+  }
+
+  void after_write (const char* data, std::size_t size)
+  {
+    if (m_policy == flush_policy::on_newline
+        && std::memchr (data, '\n', size) != nullptr)
+      {
+        flush ();
+      }
+  }
+
+  void write_all (const char* data, std::size_t size)
+  {
+    internal::count_stat (io_stat::fd_writer_flushes);
+    while (size > 0)
+      {
+        ssize_t n = ::write (m_fd, data, size);
+        if (n < 0)
+          {
+            if (errno == EINTR)
+              {
+                continue;
+              }
+            throw std::system_error (errno, std::generic_category (),
+                                     "fastio: write failed");
+          }
+        data += n;
+        size -= static_cast<std::size_t> (n);
+      }
+  }
+
+  int m_fd;
+  flush_policy m_policy;
+  bool m_flush_at_exit;
+  std::unique_ptr<char[]> m_buffer;
+  std::size_t m_capacity;
+  std::size_t m_size = 0;
+  std::uint64_t m_drained = 0;  /* Bytes written out of the buffer so far,
+                                   so contexts can find their record.  */
+};
+
+/* Format context writing straight into an fd_writer's buffer.  Call
+   commit () once formatting succeeded; output not committed by then is
+   dropped when the context is destroyed.  A record longer than the
+   whole buffer has to be written out in pieces as it is formatted;
+   if it fails, only its still-buffered tail can be dropped.  */
+class fd_writer::context : public format_context
+{
+public:
+  explicit context (fd_writer& writer) noexcept
+    : format_context (writer.m_buffer.get () + writer.m_size,
+                      writer.m_capacity - writer.m_size, &grow),
+      m_writer (writer)
+  {
+    mark ();
+  }
+
+  context (const context&) = delete;
+  context& operator= (const context&) = delete;
+
+  /* Drop the uncommitted record, or its still-buffered tail.  */
+  ~context ()
+  {
+    std::uint64_t start = m_writer.m_drained;
+    m_writer.m_size = m_start >= start ? m_start - start : 0;
+  }
+
+  void commit ()
+  {
+    m_writer.m_size += m_size;
+    m_writer.after_write (m_data, m_size);
+    set_window (m_writer.m_buffer.get () + m_writer.m_size,
+                m_writer.m_capacity - m_writer.m_size);
+    mark ();
+  }
+
+private:
+  /* Make room by writing out committed output first, sliding the
+     record to the front of the buffer; only a record that fills the
+     buffer by itself is written out before it is committed.  */
+  static void grow (format_context& ctx, std::size_t)
+  {
+    auto& self = static_cast<context&> (ctx);
+    fd_writer& writer = self.m_writer;
+    if (writer.m_size > 0)
+      {
+        writer.make_room ();
+        char* front = writer.m_buffer.get () + writer.m_size;
+        std::memmove (front, self.m_data, self.m_size);
+        self.move_window (front, writer.m_capacity - writer.m_size);
+        if (self.m_size < self.m_capacity)
+          {
+            return;
+          }
+      }
+    writer.m_size += self.m_size;
+    writer.make_room ();
+    if (writer.m_size == writer.m_capacity)
+      {
+        writer.flush ();
+      }
+    self.set_window (writer.m_buffer.get () + writer.m_size,
+                     writer.m_capacity - writer.m_size);
+  }
+
+  /* Position of the record's first byte in everything ever buffered.  */
+  void mark () noexcept
+  {
+    m_start = m_writer.m_drained + m_writer.m_size;
+  }
+
+  fd_writer& m_writer;
+  std::uint64_t m_start;
+};
+
+/* Vectored writer on a raw file descriptor.  Output is queued as an
+   array of iovecs and handed to writev(2) in one call when the batch
+   fills or on flush ().  Short pieces and owning strings are copied into
+   a staging buffer; string literals and string views of at least the
+   borrow threshold -- payloads passed to write () and string arguments
+   of the print functions -- are referenced in place, so they must stay
+   alive and unchanged until the next flush.  */
+class gather_writer
+{
+public:
+  class context;
+
+  static constexpr std::size_t default_capacity = 16 * 1024;
+  static constexpr std::size_t default_threshold = 256;
+  static constexpr std::size_t max_segments = 256;
+
+  explicit gather_writer (int fd,
+                          std::size_t capacity = default_capacity,
+                          std::size_t threshold = default_threshold,
+                          bool flush_at_exit = true)
+    : m_fd (fd),
+      m_flush_at_exit (flush_at_exit),
+      m_buffer (new char[capacity ? capacity : 1]),
+      m_capacity (capacity ? capacity : 1),
+      m_threshold (std::min (threshold, m_capacity)),
+      m_segments (new iovec[max_segments])
+  {
+  }
+
+  gather_writer (const gather_writer&) = delete;
+  gather_writer& operator= (const gather_writer&) = delete;
+
+  ~gather_writer ()
+  {
+    if (m_flush_at_exit)
+      {
+        try
+          {
+            flush ();
+          }
+        catch (...)
+          {
+          }
+      }
+  }
+
+  /* Queue DATA, by reference when it is at least the threshold long.  */
+  void write (std::string_view data)
+  {
+    if (data.size () >= m_threshold)
+      {
+        add (data.data (), data.size ());
+        return;
+      }
+    if (data.size () > m_capacity - m_size)
+      {
+        flush ();
+      }
+    char* dest = m_buffer.get () + m_size;
+    std::memcpy (dest, data.data (), data.size ());
+    m_size += data.size ();
+    add (dest, data.size ());
+  }
+
+  /* Queue a copy of DATA; an owning string may be a temporary.  */
+  template<typename T>
+    requires std::is_same_v<T, std::string>
+  void write (const T& data)
+  {
+    const char* src = data.data ();
+    std::size_t size = data.size ();
+    while (size > 0)
+      {
+        if (m_size == m_capacity)
+          {
+            flush ();
+          }
+        std::size_t n = std::min (size, m_capacity - m_size);
+        char* dest = m_buffer.get () + m_size;
+        std::memcpy (dest, src, n);
+        m_size += n;
+        add (dest, n);
+        src += n;
+        size -= n;
+      }
+  }
+
+  void put (char ch)
+  {
+    write (std::string_view (&ch, 1));
+  }
+
+  /* Write out every queued segment, resuming after partial writes.  */
+  void flush ()
+  {
+    iovec* iov = m_segments.get ();
+    std::size_t count = m_count;
+    m_count = 0;
+    m_size = 0;
+    ++m_batches;
+    if (count > 0)
+      {
+        internal::count_stat (io_stat::gather_writer_flushes);
+      }
+    while (count > 0)
+      {
+        ssize_t n = ::writev (m_fd, iov, static_cast<int> (count));
+        if (n < 0)
+          {
+            if (errno == EINTR)
+              {
+                continue;
+              }
+            throw std::system_error (errno, std::generic_category (),
+                                     "fastio: writev failed");
+          }
+        auto done = static_cast<std::size_t> (n);
+        while (count > 0 && done >= iov->iov_len)
+          {
+            done -= iov->iov_len;
+            ++iov;
+            --count;
+          }
+        if (count > 0)
+          {
+            iov->iov_base = static_cast<char*> (iov->iov_base) + done;
+            iov->iov_len -= done;
+          }
+      }
+  }
+
+  int fd () const noexcept { return m_fd; }
+  std::size_t threshold () const noexcept { return m_threshold; }
+
+  /* Number of iovecs queued for the next writev call.  */
+  std::size_t segments () const noexcept { return m_count; }
+
+private:
+  /* Queue [DATA, DATA + SIZE), extending the last segment when the two
+     are adjacent.  The batch is written as soon as it is full.  */
+  void add (const char* data, std::size_t size)
+  {
+    if (size == 0)
+      {
+        return;
+      }
+    if (m_count > 0)
+      {
+        iovec& last = m_segments[m_count - 1];
+        if (static_cast<char*> (last.iov_base) + last.iov_len == data)
+          {
+            last.iov_len += size;
+            return;
+          }
+      }
+    m_segments[m_count++] = iovec { const_cast<char*> (data), size };
+    if (m_count == max_segments)
+      {
+        flush ();
+      }
+  }
+
+  int m_fd;
+  bool m_flush_at_exit;
+  std::unique_ptr<char[]> m_buffer;
+  std::size_t m_capacity;
+  std::size_t m_size = 0;
+  std::size_t m_threshold;
+  std::unique_ptr<iovec[]> m_segments;
+  std::size_t m_count = 0;
+  std::size_t m_batches = 0;
+};
+
+/* Format context over a gather_writer's staging buffer.  Large string
+   arguments become segments of their own; call commit () once
+   formatting succeeded, or the record is dropped again unless the
+   batch had to be written in the middle of it.  */
+class gather_writer::context : public format_context
+{
+public:
+  explicit context (gather_writer& writer) noexcept
+    : format_context (writer.m_buffer.get () + writer.m_size,
+                      writer.m_capacity - writer.m_size, &grow),
+      m_writer (writer)
+  {
+    set_borrow (&borrow, writer.m_threshold);
+    mark ();
+  }
+
+  context (const context&) = delete;
+  context& operator= (const context&) = delete;
+
+  /* Unqueue an uncommitted record, or what is left of it when part of
+     it has already been written.  */
+  ~context ()
+  {
+    if (m_writer.m_batches != m_batch_mark)
+      {
+        m_writer.m_count = 0;
+        m_writer.m_size = 0;
+        return;
+      }
+    m_writer.m_count = m_count_mark;
+    m_writer.m_size = m_size_mark;
+    if (m_count_mark > 0)
+      {
+        m_writer.m_segments[m_count_mark - 1].iov_len = m_length_mark;
+      }
+  }
+
+  void commit ()
+  {
+    take_window ();
+    mark ();
+  }
+
+private:
+  /* Queue the bytes formatted into the window so far.  */
+  void take_window ()
+  {
+    m_writer.m_size += m_size;
+    m_writer.add (m_data, m_size);
+    set_window (m_writer.m_buffer.get () + m_writer.m_size,
+                m_writer.m_capacity - m_writer.m_size);
+  }
+
+  void mark () noexcept
+  {
+    m_batch_mark = m_writer.m_batches;
+    m_count_mark = m_writer.m_count;
+    m_size_mark = m_writer.m_size;
+    m_length_mark = m_count_mark > 0
+                      ? m_writer.m_segments[m_count_mark - 1].iov_len : 0;
+  }
+
+  static void grow (format_context& ctx, std::size_t min_extra)
+  {
+    auto& self = static_cast<context&> (ctx);
+    gather_writer& writer = self.m_writer;
+    self.take_window ();
+    if (writer.m_capacity - writer.m_size < std::max<std::size_t> (min_extra, 1))
+      {
+        writer.flush ();
+        self.set_window (writer.m_buffer.get (), writer.m_capacity);
+      }
+  }
+
+  static void borrow (format_context& ctx, std::string_view str)
+  {
+    auto& self = static_cast<context&> (ctx);
+    gather_writer& writer = self.m_writer;
+    self.take_window ();
+    writer.add (str.data (), str.size ());
+    self.set_window (writer.m_buffer.get () + writer.m_size,
+                     writer.m_capacity - writer.m_size);
+  }
+
+  gather_writer& m_writer;
+  std::size_t m_batch_mark = 0;
+  std::size_t m_count_mark = 0;
+  std::size_t m_size_mark = 0;
+  std::size_t m_length_mark = 0;
+};
+
+/* Sinks the print functions can target besides std::ostream: buffered
+   writers exposing a format context over their own storage.  */
+template<typename Sink>
+concept buffered_sink = requires (Sink& sink, std::string_view str)
+{
+  typename Sink::context;
+  sink.write (str);
+  sink.put ('\n');
+  sink.flush ();
+};
+
+/* Buffered writer for standard output.  Line-flushed on a terminal,
+   flushed when full otherwise; flushed at exit either way.  */
+inline fd_writer& out ()
+{
+  static fd_writer writer (STDOUT_FILENO,
+                           ::isatty (STDOUT_FILENO) ? flush_policy::on_newline
+                                                    : flush_policy::on_size);
+  return writer;
+}
+
+/* This thread's own buffered writer for standard output.  Each thread
+   collects whole lines in a PIPE_BUF-sized buffer and hands them to
+   write(2) in one piece, so concurrent println calls never interleave
+   inside a line and need no shared lock.  On a terminal every line is
+   written at once; otherwise lines are batched.  Flushed at thread
+   exit; output of different threads is ordered only line by line.  */
+inline fd_writer& thread_out ()
+{
+  thread_local fd_writer writer (STDOUT_FILENO,
+                                 ::isatty (STDOUT_FILENO)
+                                   ? flush_policy::on_newline
+                                   : flush_policy::whole_lines,
+                                 PIPE_BUF);
+  return writer;
+}
+
+/* Buffered writer for standard error, line-flushed.  */
+inline fd_writer& err ()
+{
+  static fd_writer writer (STDERR_FILENO, flush_policy::on_newline);
+  return writer;
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_OUTPUT_HPP */
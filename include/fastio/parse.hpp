@@ -0,0 +1,246 @@
+/* parse.hpp - Integer parsing for FastIO.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_PARSE_HPP
+#define FASTIO_PARSE_HPP
+
+#include "scan.hpp"
+#include <bit>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace fastio {
+
+/* Integer types the parsers accept; like std::from_chars, not bool.  */
+template<typename T>
+concept parsable_integer = std::integral<T> && !std::same_as<T, bool>;
+
+namespace internal
+{
+  /* SWAR digit handling: eight ASCII bytes are processed as one 64-bit
+     little-endian word.  */
+  namespace swar
+  {
+    inline constexpr std::uint64_t zeros = 0x3030303030303030ull;
+
+    inline std::uint64_t load8 (const char* p) noexcept
+    {
+      std::uint64_t word;
+      std::memcpy (&word, p, sizeof word);
+      return word;
+    }
+
+    /* High bit set in every byte that is not '0'..'9'.  Borrows and
+       carries only move towards later bytes, so the lowest flagged
+       byte is always exact.  */
+    inline std::uint64_t non_digits (std::uint64_t word) noexcept
+    {
+      return ((word + 0x4646464646464646ull) | (word - zeros))
+             & 0x8080808080808080ull;
+    }
+
+    /* Value of eight digit bytes, first byte most significant.  */
+    inline std::uint32_t value8 (std::uint64_t word) noexcept
+    {
+      word -= zeros;
+      word = word * 10 + (word >> 8);
+      word = (((word & 0x000000ff000000ffull) * 0x000f424000000064ull)
+              + (((word >> 16) & 0x000000ff000000ffull)
+                 * 0x0000271000000001ull)) >> 32;
+      return static_cast<std::uint32_t> (word);
+    }
+  }
+
+  inline constexpr std::uint64_t small_powers_of_10[8] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000
+  };
+
+  /* Accumulate the decimal digits at FIRST into VALUE and return the
+     first non-digit.  Sixteen digits cannot overflow 64 bits, so up to
+     two words go through SWAR unchecked; longer numbers continue one
+     checked digit at a time.  On overflow the remaining digits are
+     still consumed, as std::from_chars does.  */
+  inline const char* parse_digits (const char* first, const char* last,
+                                   std::uint64_t& value, bool& overflow) noexcept
+  {
+    value = 0;
+    overflow = false;
+    while (first != last && *first == '0')
+      {
+        ++first;
+      }
+    if constexpr (std::endian::native == std::endian::little)
+      {
+        for (int block = 0; block < 2 && last - first >= 8; ++block)
+          {
+            std::uint64_t word = swar::load8 (first);
+            std::uint64_t stop = swar::non_digits (word);
+            if (stop != 0)
+              {
+                int n = std::countr_zero (stop) >> 3;
+                if (n > 0)
+                  {
+                    /* Left-align the N digits and pad with '0'.  */
+                    word = (word << (64 - 8 * n)) | (swar::zeros >> (8 * n));
+                    value = value * small_powers_of_10[n] + swar::value8 (word);
+                  }
+                return first + n;
+              }
+            value = value * 100000000 + swar::value8 (word);
+            first += 8;
+          }
+      }
+    for (; first != last; ++first)
+      {
+        unsigned digit = static_cast<unsigned char> (*first) - '0';
+        if (digit > 9)
+          {
+            break;
+          }
+        if (!overflow)
+          {
+            overflow = __builtin_mul_overflow (value, 10u, &value)
+                       || __builtin_add_overflow (value, digit, &value);
+          }
+      }
+    return first;
+  }
+
+  /* Base-10 drop-in for std::from_chars on integers.  */
+  template<parsable_integer T>
+  inline std::from_chars_result parse_integer (const char* first,
+                                               const char* last,
+                                               T& value) noexcept
+  {
+    using unsigned_type = std::make_unsigned_t<T>;
+    bool negative = false;
+    const char* digits = first;
+    if constexpr (std::is_signed_v<T>)
+      {
+        if (digits != last && *digits == '-')
+          {
+            negative = true;
+            ++digits;
+          }
+      }
+
+    std::uint64_t magnitude;
+    bool overflow;
+    const char* end = parse_digits (digits, last, magnitude, overflow);
+    if (end == digits)
+      {
+        return { first, std::errc::invalid_argument };
+      }
+
+    std::uint64_t limit = std::numeric_limits<T>::max ();
+    if (negative)
+      {
+        ++limit;
+      }
+    if (overflow || magnitude > limit)
+      {
+        return { end, std::errc::result_out_of_range };
+      }
+
+    unsigned_type bits = static_cast<unsigned_type> (magnitude);
+    value = static_cast<T> (negative ? unsigned_type (0 - bits) : bits);
+    return { end, std::errc () };
+  }
+}
+
+/* Parse all of STR as a base-10 integer without throwing.  Fails with
+   invalid_argument when STR is not entirely a number and with
+   result_out_of_range when the number does not fit in T.  */
+template<parsable_integer T>
+inline std::expected<T, std::errc> try_parse_int (std::string_view str) noexcept
+{
+  T value;
+  const char* last = str.data () + str.size ();
+  auto [ptr, ec] = internal::parse_integer (str.data (), last, value);
+  if (ec != std::errc ())
+    {
+      return std::unexpected (ec);
+    }
+  if (ptr != last)
+    {
+      return std::unexpected (std::errc::invalid_argument);
+    }
+  return value;
+}
+
+/* Outcome of parse_ints: COUNT values were stored, parsing stopped at
+   PTR, and EC says why if it was not the end of the input.  */
+struct parse_ints_result
+{
+  std::size_t count;
+  const char* ptr;
+  std::errc ec;
+};
+
+/* Parse integers separated by whitespace and/or a single DELIM (e.g.
+   the commas and newlines of a numeric CSV) from TEXT into OUT.  Stops
+   when OUT is full, at the end of TEXT, or at the first malformed
+   number or empty field.  */
+template<parsable_integer T>
+parse_ints_result parse_ints (std::string_view text, std::span<T> out,
+                              char delim = ',') noexcept
+{
+  const char* p = text.data ();
+  const char* last = p + text.size ();
+  std::size_t count = 0;
+
+  p = internal::scalar::skip_space (p, last);
+  while (p != last && count != out.size ())
+    {
+      auto [end, ec] = internal::parse_integer (p, last, out[count]);
+      if (ec != std::errc ())
+        {
+          return { count, end, ec };
+        }
+      ++count;
+      /* Common case first: one delimiter and no padding.  */
+      if (last - end > 1 && *end == delim && !internal::is_space (end[1]))
+        {
+          p = end + 1;
+          continue;
+        }
+      p = internal::scalar::skip_space (end, last);
+      if (p != last && *p == delim)
+        {
+          p = internal::scalar::skip_space (p + 1, last);
+        }
+      else if (p == end && p != last)
+        {
+          /* Number directly followed by something else: "12a".  */
+          return { count, p, std::errc::invalid_argument };
+        }
+    }
+  return { count, p, std::errc () };
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_PARSE_HPP */
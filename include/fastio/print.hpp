@@ -20,11 +20,19 @@
 #define FASTIO_PRINT_HPP
 
 #include "format.hpp"
+#include "compile.hpp"
+#include "output.hpp"
 #include <iostream>
+#include <iterator>
 #include <charconv>
 
 namespace fastio {
 
+/* Anything the print functions can write to.  */
+template<typename Stream>
+concept print_target = std::derived_from<Stream, std::ostream>
+                       || buffered_sink<Stream>;
+
 namespace internal
 {
   /* Fast integer output to stream.  */
@@ -32,9 +40,8 @@ namespace internal
     requires (std::integral<T> && !std::is_same_v<T, bool>)
   inline void write_integer (std::ostream& os, T value)
   {
-    char buffer[32];
-    auto [ptr, ec] = std::to_chars (buffer, buffer + sizeof (buffer), value);
-    os.write (buffer, ptr - buffer);
+    char buffer[max_decimal_size<T>];
+    os.write (buffer, write_decimal (buffer, value) - buffer);
   }
 
   /* Optimized stream output with type dispatch.  */
@@ -49,6 +56,18 @@ namespace internal
       {
         write_integer (os, value);
       }
+    else if constexpr (std::floating_point<T> || is_float_format_v<T>)
+      {
+        internal::float_chars chars (value);
+        os.write (chars.view ().data (), chars.view ().size ());
+      }
+    else if constexpr (has_formatter<T>)
+      {
+        iterator_context<std::ostreambuf_iterator<char>> ctx
+          { std::ostreambuf_iterator<char> (os) };
+        formatter<T> {}.format (value, ctx);
+        std::move (ctx).out ();
+      }
     else
       {
         os << value;
@@ -75,6 +94,124 @@ namespace internal
   }
 
   inline void print_with_spaces_impl (std::ostream&) {}
+
+  template<bool Spaced, bool Newline, typename... Args>
+  void print_args (std::ostream& os, const Args&... args)
+  {
+    count_stat (io_stat::print_calls);
+    if constexpr (Spaced)
+      {
+        print_with_spaces_impl (os, args...);
+      }
+    else
+      {
+        print_impl (os, args...);
+      }
+    if constexpr (Newline)
+      {
+        os.put ('\n');
+      }
+  }
+
+  /* Buffered sinks: all arguments are formatted straight into the
+     sink's buffer and committed as one record.  */
+  template<bool Spaced, bool Newline, buffered_sink Sink, typename... Args>
+  void print_args (Sink& out, const Args&... args)
+  {
+    count_stat (io_stat::print_calls);
+    typename Sink::context ctx (out);
+    bool first = true;
+    auto one = [&] (const auto& value) {
+      if (Spaced && !first)
+        {
+          ctx.push_back (' ');
+        }
+      first = false;
+      format_value_to (ctx, value);
+    };
+    (one (args), ...);
+    if constexpr (Newline)
+      {
+        ctx.push_back ('\n');
+      }
+    count_stat (io_stat::bytes_formatted, ctx.size ());
+    ctx.commit ();
+  }
+
+  /* Formatted output to a stream, staged through its streambuf rather
+     than a temporary string.  */
+  template<bool Newline, typename Write>
+  void print_formatted (std::ostream& os, Write write)
+  {
+    count_stat (io_stat::print_calls);
+    std::ostream::sentry guard (os);
+    if (!guard)
+      {
+        return;
+      }
+    iterator_context<std::ostreambuf_iterator<char>> ctx
+      { std::ostreambuf_iterator<char> (os) };
+    write (ctx);
+    if constexpr (Newline)
+      {
+        ctx.push_back ('\n');
+      }
+    if (std::move (ctx).out ().failed ())
+      {
+        os.setstate (std::ios_base::badbit);
+      }
+  }
+
+  template<bool Newline, buffered_sink Sink, typename Write>
+  void print_formatted (Sink& out, Write write)
+  {
+    count_stat (io_stat::print_calls);
+    typename Sink::context ctx (out);
+    write (ctx);
+    if constexpr (Newline)
+      {
+        ctx.push_back ('\n');
+      }
+    ctx.commit ();
+  }
+
+  template<bool Newline, typename Stream, typename... Args>
+  void print_fmt_to (Stream& os, const compile_format_string& fmt,
+                     const Args&... args)
+  {
+    format_args<sizeof...(Args)> fargs (args...);
+    print_formatted<Newline> (os, [&] (format_context& ctx) {
+      vformat_to (ctx, fmt, fargs);
+    });
+  }
+
+  template<bool Newline, typename Stream, fixed_string Str, typename... Args>
+  void print_fmt_to (Stream& os, compiled_string<Str> fmt, const Args&... args)
+  {
+    print_formatted<Newline> (os, [&] (format_context& ctx) {
+      compiled_format_to (ctx, fmt, args...);
+    });
+  }
+
+  /* Target of print, println, ...: std::cout, fastio::out () when
+     FASTIO_USE_FD_OUTPUT is defined, or the calling thread's
+     fastio::thread_out () when FASTIO_THREAD_LOCAL_OUTPUT is.  */
+#if defined(FASTIO_THREAD_LOCAL_OUTPUT)
+  inline fd_writer& default_out ()
+  {
+    return thread_out ();
+  }
+#elif defined(FASTIO_USE_FD_OUTPUT)
+  inline fd_writer& default_out ()
+  {
+    return out ();
+  }
+#else
+  inline std::ostream& default_out ()
+  {
+    return std::cout;
+  }
+#endif
 }
 
 /* ==================== PUBLIC INTERFACE ==================== */
@@ -83,80 +220,114 @@ namespace internal
 template<typename... Args>
 inline void print (const Args&... args)
 {
-  internal::print_impl (std::cout, args...);
+  internal::print_args<false, false> (internal::default_out (), args...);
 }
 
 template<typename... Args>
 inline void println (const Args&... args)
 {
-  internal::print_impl (std::cout, args...);
-  std::cout.put ('\n');
+  internal::print_args<false, true> (internal::default_out (), args...);
 }
 
 /* Print arguments with spaces between them.  */
 template<typename... Args>
 inline void print_spaced (const Args&... args)
 {
-  internal::print_with_spaces_impl (std::cout, args...);
+  internal::print_args<true, false> (internal::default_out (), args...);
 }
 
 template<typename... Args>
 inline void println_spaced (const Args&... args)
 {
-  internal::print_with_spaces_impl (std::cout, args...);
-  std::cout.put ('\n');
+  internal::print_args<true, true> (internal::default_out (), args...);
 }
 
 /* Print formatted string.  */
 template<typename... Args>
 inline void print_fmt (compile_format_string fmt, const Args&... args)
 {
-  std::cout << format (fmt, args...);
+  internal::print_fmt_to<false> (internal::default_out (), fmt, args...);
 }
 
 template<typename... Args>
 inline void println_fmt (compile_format_string fmt, const Args&... args)
 {
-  std::cout << format (fmt, args...) << '\n';
+  internal::print_fmt_to<true> (internal::default_out (), fmt, args...);
 }
 
-/* Stream-specific versions.  */
-template<typename... Args>
-inline void fprint (std::ostream& os, const Args&... args)
+/* Print with a compiled format string.  */
+template<fixed_string Str, typename... Args>
+inline void print_fmt (compiled_string<Str> fmt, const Args&... args)
 {
-  internal::print_impl (os, args...);
+  internal::print_fmt_to<false> (internal::default_out (), fmt, args...);
 }
 
-template<typename... Args>
-inline void fprintln (std::ostream& os, const Args&... args)
+template<fixed_string Str, typename... Args>
+inline void println_fmt (compiled_string<Str> fmt, const Args&... args)
 {
-  internal::print_impl (os, args...);
-  os.put ('\n');
+  internal::print_fmt_to<true> (internal::default_out (), fmt, args...);
 }
 
-template<typename... Args>
-inline void fprint_spaced (std::ostream& os, const Args&... args)
+/* Stream-specific versions.  OS is any std::ostream or buffered sink
+   such as fastio::out ().  */
+template<print_target Stream, typename... Args>
+inline void fprint (Stream& os, const Args&... args)
 {
-  internal::print_with_spaces_impl (os, args...);
+  internal::print_args<false, false> (os, args...);
 }
 
-template<typename... Args>
-inline void fprintln_spaced (std::ostream& os, const Args&... args)
+template<print_target Stream, typename... Args>
+inline void fprintln (Stream& os, const Args&... args)
 {
-  internal::print_with_spaces_impl (os, args...);
-  os.put ('\n');
+  internal::print_args<false, true> (os, args...);
 }
 
-template<typename... Args>
-inline void fprint_fmt (std::ostream& os, compile_format_string fmt, const Args&... args)
+template<print_target Stream, typename... Args>
+inline void fprint_spaced (Stream& os, const Args&... args)
 {
-  os << format (fmt, args...);
+  internal::print_args<true, false> (os, args...);
 }
 
-template<typename... Args>
-inline void fprintln_fmt (std::ostream& os, compile_format_string fmt, const Args&... args)
+template<print_target Stream, typename... Args>
+inline void fprintln_spaced (Stream& os, const Args&... args)
+{
+  internal::print_args<true, true> (os, args...);
+}
+
+template<print_target Stream, typename... Args>
+inline void fprint_fmt (Stream& os, compile_format_string fmt, const Args&... args)
+{
+  internal::print_fmt_to<false> (os, fmt, args...);
+}
+
+template<print_target Stream, typename... Args>
+inline void fprintln_fmt (Stream& os, compile_format_string fmt, const Args&... args)
+{
+  internal::print_fmt_to<true> (os, fmt, args...);
+}
+
+template<print_target Stream, fixed_string Str, typename... Args>
+inline void fprint_fmt (Stream& os, compiled_string<Str> fmt, const Args&... args)
+{
+  internal::print_fmt_to<false> (os, fmt, args...);
+}
+
+template<print_target Stream, fixed_string Str, typename... Args>
+inline void fprintln_fmt (Stream& os, compiled_string<Str> fmt, const Args&... args)
+{
+  internal::print_fmt_to<true> (os, fmt, args...);
+}
+
+/* Print the totals of stats (), one "name value" line per counter,
+   e.g. fastio::dump_stats (std::cerr) before exiting.  */
+template<print_target Stream>
+void dump_stats (Stream& os)
 {
-  os << format (fmt, args...) << '\n';
+  io_stats totals = stats ();
+  for (std::size_t i = 0; i < stat_count; ++i)
+    {
+      fprintln_fmt (os, "{:<22} {}", stat_names[i], totals.counts[i]);
+    }
 }
 
 } /* namespace fastio */
@@ -0,0 +1,197 @@
+/* ranges.hpp - Range, tuple and map formatting for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_RANGES_HPP
+#define FASTIO_RANGES_HPP
+
+#include "format.hpp"
+#include <cstddef>
+#include <ranges>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace fastio {
+
+/* Ranges formatted element by element: anything iterable that is not
+   already a string and does not contain itself (like a path).  */
+template<typename R>
+concept formattable_range
+  = std::ranges::input_range<const R>
+    && !std::is_convertible_v<const R&, std::string_view>
+    && !std::is_same_v<std::remove_cvref_t<std::ranges::range_reference_t<const R>>,
+                       R>;
+
+/* Associative containers, formatted as {key: value, ...}.  */
+template<typename R>
+concept map_like = formattable_range<R> && requires
+{
+  typename R::key_type;
+  typename R::mapped_type;
+};
+
+/* Elements of RANGE separated by SEPARATOR, without brackets.  */
+template<typename R>
+struct join_view
+{
+  const R& range;
+  std::string_view separator;
+};
+
+template<typename R>
+  requires formattable_range<R>
+join_view<R> join (const R& range, std::string_view separator)
+{
+  return { range, separator };
+}
+
+namespace internal
+{
+  /* Write the elements of RANGE into CTX, SEPARATOR between them.  Map
+     entries are written as key: value.  */
+  template<bool Map, typename R>
+  void format_range (format_context& ctx, const R& range,
+                     std::string_view separator)
+  {
+    bool first = true;
+    for (const auto& element : range)
+      {
+        if (!first)
+          {
+            ctx.append (separator);
+          }
+        first = false;
+        if constexpr (Map)
+          {
+            format_value_to (ctx, element.first);
+            ctx.append (": ");
+            format_value_to (ctx, element.second);
+          }
+        else
+          {
+            format_value_to (ctx, element);
+          }
+      }
+  }
+
+  /* Space to reserve for RANGE: the longest form of every element for
+     sized ranges of numbers, so a large vector is formatted without
+     the buffer growing; a flat guess otherwise.  */
+  template<typename R>
+  std::size_t range_size_hint (const R& range, std::size_t separator)
+  {
+    using value_type = std::remove_cv_t<std::ranges::range_value_t<const R>>;
+    if constexpr (std::ranges::sized_range<const R>
+                  && std::is_arithmetic_v<value_type>)
+      {
+        std::size_t element = 24;
+        if constexpr (std::is_same_v<value_type, bool>)
+          {
+            element = 5;
+          }
+        else if constexpr (std::integral<value_type>)
+          {
+            element = max_decimal_size<value_type>;
+          }
+        return 2 + std::ranges::size (range) * (element + separator);
+      }
+    else
+      {
+        return 32;
+      }
+  }
+
+  template<typename Tuple, std::size_t... I>
+  void format_tuple (format_context& ctx, const Tuple& value,
+                     std::index_sequence<I...>)
+  {
+    ctx.push_back ('(');
+    ((I == 0 ? void () : ctx.append (", "),
+      format_value_to (ctx, std::get<I> (value))), ...);
+    ctx.push_back (')');
+  }
+}
+
+/* [1, 2, 3] for ranges.  */
+template<typename R>
+  requires (formattable_range<R> && !map_like<R>)
+struct formatter<R>
+{
+  void format (const R& range, format_context& ctx) const
+  {
+    ctx.push_back ('[');
+    internal::format_range<false> (ctx, range, ", ");
+    ctx.push_back (']');
+  }
+
+  std::size_t size_hint (const R& range) const
+  {
+    return internal::range_size_hint (range, 2);
+  }
+};
+
+/* {key: value, ...} for maps.  */
+template<typename R>
+  requires map_like<R>
+struct formatter<R>
+{
+  void format (const R& range, format_context& ctx) const
+  {
+    ctx.push_back ('{');
+    internal::format_range<true> (ctx, range, ", ");
+    ctx.push_back ('}');
+  }
+};
+
+template<typename R>
+struct formatter<join_view<R>>
+{
+  void format (const join_view<R>& view, format_context& ctx) const
+  {
+    internal::format_range<map_like<R>> (ctx, view.range, view.separator);
+  }
+
+  std::size_t size_hint (const join_view<R>& view) const
+  {
+    return internal::range_size_hint (view.range, view.separator.size ());
+  }
+};
+
+/* (a, b) for pairs and (a, b, c) for tuples.  */
+template<typename First, typename Second>
+struct formatter<std::pair<First, Second>>
+{
+  void format (const std::pair<First, Second>& value, format_context& ctx) const
+  {
+    internal::format_tuple (ctx, value, std::index_sequence_for<First, Second> {});
+  }
+};
+
+template<typename... Types>
+struct formatter<std::tuple<Types...>>
+{
+  void format (const std::tuple<Types...>& value, format_context& ctx) const
+  {
+    internal::format_tuple (ctx, value, std::index_sequence_for<Types...> {});
+  }
+};
+
+} /* namespace fastio */
+
+#endif /* FASTIO_RANGES_HPP */
@@ -0,0 +1,410 @@
+/* scan.hpp - Vectorized delimiter scanning for FastIO.
+   Copyright (C) 2025 deotermia
+   
+   This file is part of FastIO, a fast I/O library for C++.
+   
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_SCAN_HPP
+#define FASTIO_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+/* SSE2 is part of the x86-64 baseline; AVX2 is chosen at run time.
+   Define FASTIO_NO_SIMD to build the scalar kernels only.  */
+#if !defined(FASTIO_NO_SIMD) && defined(__x86_64__) \
+    && (defined(__GNUC__) || defined(__clang__))
+#define FASTIO_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace fastio {
+
+namespace internal
+{
+  /* Same set as std::isspace in the "C" locale, without the locale.  */
+  constexpr bool is_space (char ch) noexcept
+  {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+  }
+
+  /* Byte-at-a-time kernels: the fallback, and the tail of every vector
+     loop.  Each returns LAST when nothing matches.  */
+  namespace scalar
+  {
+    constexpr const char* find_char (const char* first, const char* last,
+                                     char ch) noexcept
+    {
+      while (first != last && *first != ch)
+        {
+          ++first;
+        }
+      return first;
+    }
+
+    constexpr const char* find_space (const char* first,
+                                      const char* last) noexcept
+    {
+      while (first != last && !is_space (*first))
+        {
+          ++first;
+        }
+      return first;
+    }
+
+    constexpr const char* skip_space (const char* first,
+                                      const char* last) noexcept
+    {
+      while (first != last && is_space (*first))
+        {
+          ++first;
+        }
+      return first;
+    }
+  }
+
+#ifdef FASTIO_X86_SIMD
+  /* Whitespace test on a vector: ' ', or '\t'..'\r' checked as the
+     unsigned range (x - '\t') <= 4.  */
+  namespace sse2
+  {
+    inline unsigned space_mask (__m128i v) noexcept
+    {
+      __m128i t = _mm_sub_epi8 (v, _mm_set1_epi8 ('\t'));
+      __m128i range = _mm_cmpeq_epi8 (_mm_min_epu8 (t, _mm_set1_epi8 (4)), t);
+      __m128i blank = _mm_cmpeq_epi8 (v, _mm_set1_epi8 (' '));
+      return static_cast<unsigned> (_mm_movemask_epi8 (_mm_or_si128 (range,
+                                                                     blank)));
+    }
+
+    inline unsigned char_mask (__m128i v, char ch) noexcept
+    {
+      return static_cast<unsigned> (
+        _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 (ch))));
+    }
+
+    inline __m128i load (const char* p) noexcept
+    {
+      return _mm_loadu_si128 (reinterpret_cast<const __m128i*> (p));
+    }
+
+    inline std::uint64_t space_block (const char* p) noexcept
+    {
+      return std::uint64_t (space_mask (load (p)))
+             | std::uint64_t (space_mask (load (p + 16))) << 16
+             | std::uint64_t (space_mask (load (p + 32))) << 32
+             | std::uint64_t (space_mask (load (p + 48))) << 48;
+    }
+
+    inline std::uint64_t char_block (const char* p, char ch) noexcept
+    {
+      return std::uint64_t (char_mask (load (p), ch))
+             | std::uint64_t (char_mask (load (p + 16), ch)) << 16
+             | std::uint64_t (char_mask (load (p + 32), ch)) << 32
+             | std::uint64_t (char_mask (load (p + 48), ch)) << 48;
+    }
+
+    inline const char* find_char (const char* first, const char* last,
+                                  char ch) noexcept
+    {
+      for (; last - first >= 16; first += 16)
+        {
+          unsigned mask = char_mask (load (first), ch);
+          if (mask != 0)
+            {
+              return first + __builtin_ctz (mask);
+            }
+        }
+      return scalar::find_char (first, last, ch);
+    }
+  }
+
+  namespace avx2
+  {
+    __attribute__ ((target ("avx2")))
+    inline unsigned space_mask (__m256i v) noexcept
+    {
+      __m256i t = _mm256_sub_epi8 (v, _mm256_set1_epi8 ('\t'));
+      __m256i range = _mm256_cmpeq_epi8 (
+        _mm256_min_epu8 (t, _mm256_set1_epi8 (4)), t);
+      __m256i blank = _mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (' '));
+      return static_cast<unsigned> (
+        _mm256_movemask_epi8 (_mm256_or_si256 (range, blank)));
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline unsigned char_mask (__m256i v, char ch) noexcept
+    {
+      return static_cast<unsigned> (
+        _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (ch))));
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline __m256i load (const char* p) noexcept
+    {
+      return _mm256_loadu_si256 (reinterpret_cast<const __m256i*> (p));
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline std::uint64_t space_block (const char* p) noexcept
+    {
+      return std::uint64_t (space_mask (load (p)))
+             | std::uint64_t (space_mask (load (p + 32))) << 32;
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline std::uint64_t char_block (const char* p, char ch) noexcept
+    {
+      return std::uint64_t (char_mask (load (p), ch))
+             | std::uint64_t (char_mask (load (p + 32), ch)) << 32;
+    }
+
+    __attribute__ ((target ("avx2")))
+    inline const char* find_char (const char* first, const char* last,
+                                  char ch) noexcept
+    {
+      for (; last - first >= 32; first += 32)
+        {
+          unsigned mask = char_mask (load (first), ch);
+          if (mask != 0)
+            {
+              return first + __builtin_ctz (mask);
+            }
+        }
+      return sse2::find_char (first, last, ch);
+    }
+  }
+
+  /* Checked once per process.  */
+  inline bool cpu_has_avx2 () noexcept
+  {
+    static const bool has_avx2 = __builtin_cpu_supports ("avx2");
+    return has_avx2;
+  }
+#endif
+
+  /* First CH in [FIRST, LAST), or LAST.  Lines are usually longer than
+     a vector, so this scans straight ahead, checking the first 16 bytes
+     inline before calling into the wider loop.  */
+  inline const char* find_char (const char* first, const char* last,
+                                char ch) noexcept
+  {
+#ifdef FASTIO_X86_SIMD
+    if (last - first >= 16)
+      {
+        unsigned mask = sse2::char_mask (sse2::load (first), ch);
+        if (mask != 0)
+          {
+            return first + __builtin_ctz (mask);
+          }
+        first += 16;
+      }
+    return cpu_has_avx2 () ? avx2::find_char (first, last, ch)
+                           : sse2::find_char (first, last, ch);
+#else
+    return scalar::find_char (first, last, ch);
+#endif
+  }
+
+  inline const char* find_newline (const char* first, const char* last) noexcept
+  {
+    return find_char (first, last, '\n');
+  }
+
+  /* Byte classes for block_index: each classifies 64 bytes at once into
+     a bit mask, bit I standing for byte I.  */
+  struct space_class
+  {
+    bool test (char ch) const noexcept { return is_space (ch); }
+
+    std::uint64_t block (const char* p) const noexcept
+    {
+#ifdef FASTIO_X86_SIMD
+      return cpu_has_avx2 () ? avx2::space_block (p) : sse2::space_block (p);
+#else
+      std::uint64_t mask = 0;
+      for (int i = 0; i < 64; ++i)
+        {
+          mask |= std::uint64_t (is_space (p[i])) << i;
+        }
+      return mask;
+#endif
+    }
+  };
+
+  struct char_class
+  {
+    char ch;
+
+    bool test (char c) const noexcept { return c == ch; }
+
+    std::uint64_t block (const char* p) const noexcept
+    {
+#ifdef FASTIO_X86_SIMD
+      return cpu_has_avx2 () ? avx2::char_block (p, ch)
+                             : sse2::char_block (p, ch);
+#else
+      std::uint64_t mask = 0;
+      for (int i = 0; i < 64; ++i)
+        {
+          mask |= std::uint64_t (p[i] == ch) << i;
+        }
+      return mask;
+#endif
+    }
+  };
+
+  /* Cursor-side index of which bytes belong to CLASS.  Tokens are often
+     shorter than a vector, so rather than running a kernel per token it
+     classifies input 64 bytes at a time and answers each query from the
+     cached mask with a shift and a count of trailing zeros.  Every byte
+     is classified once as long as queries move forward.  The owner must
+     call reset () whenever the bytes under the cursor change.  */
+  template<typename Class>
+  class block_index
+  {
+  public:
+    explicit block_index (Class cls = {}) noexcept : m_class (cls) {}
+
+    void reset () noexcept
+    {
+      m_block = nullptr;
+      m_size = 0;
+    }
+
+    /* First byte in [FIRST, LAST) that is in the class (MATCH) or is
+       not (!MATCH); LAST if there is none.  */
+    template<bool Match>
+    const char* find (const char* first, const char* last) noexcept
+    {
+      while (first < last)
+        {
+          if (first < m_block || first >= m_block + m_size)
+            {
+              load (first, last);
+            }
+          std::uint64_t bits = (Match ? m_mask : ~m_mask) >> (first - m_block);
+          if (bits != 0)
+            {
+              const char* found = first + __builtin_ctzll (bits);
+              return found < last ? found : last;
+            }
+          first = m_block + m_size;
+        }
+      return last;
+    }
+
+  private:
+    void load (const char* first, const char* last) noexcept
+    {
+      m_block = first;
+      if (last - first >= 64)
+        {
+          m_mask = m_class.block (first);
+          m_size = 64;
+          return;
+        }
+      m_size = static_cast<std::size_t> (last - first);
+      m_mask = 0;
+      for (std::size_t i = 0; i < m_size; ++i)
+        {
+          m_mask |= std::uint64_t (m_class.test (first[i])) << i;
+        }
+    }
+
+    Class m_class;
+    const char* m_block = nullptr;
+    std::size_t m_size = 0;
+    std::uint64_t m_mask = 0;
+  };
+
+  using space_index = block_index<space_class>;
+}
+
+/* Fields of TEXT separated by DELIM: "a,,b," gives "a", "", "b", "".
+   Empty text has no fields.  */
+class split_view
+{
+public:
+  class iterator
+  {
+  public:
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+
+    iterator () = default;
+
+    iterator (const char* first, const char* last, char delim) noexcept
+      : m_next (first), m_last (last), m_index (internal::char_class {delim}),
+        m_done (first == last)
+    {
+      ++*this;
+    }
+
+    std::string_view operator* () const noexcept { return m_current; }
+
+    iterator& operator++ () noexcept
+    {
+      if (m_next == nullptr)
+        {
+          m_done = true;
+          return *this;
+        }
+      const char* end = m_index.find<true> (m_next, m_last);
+      m_current = std::string_view (m_next, end - m_next);
+      m_next = end == m_last ? nullptr : end + 1;
+      return *this;
+    }
+
+    void operator++ (int) noexcept { ++*this; }
+
+    bool operator== (std::default_sentinel_t) const noexcept { return m_done; }
+
+  private:
+    const char* m_next = nullptr;
+    const char* m_last = nullptr;
+    internal::block_index<internal::char_class> m_index;
+    bool m_done = true;
+    std::string_view m_current;
+  };
+
+  split_view (std::string_view text, char delim) noexcept
+    : m_text (text), m_delim (delim)
+  {
+  }
+
+  iterator begin () const noexcept
+  {
+    return iterator (m_text.data (), m_text.data () + m_text.size (), m_delim);
+  }
+
+  std::default_sentinel_t end () const noexcept { return {}; }
+
+private:
+  std::string_view m_text;
+  char m_delim;
+};
+
+/* for (std::string_view field : fastio::split (row, ',')) ...  */
+inline split_view split (std::string_view text, char delim) noexcept
+{
+  return split_view (text, delim);
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_SCAN_HPP */
@@ -0,0 +1,225 @@
+/* small_string.hpp - Inline fixed-capacity format results for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_SMALL_STRING_HPP
+#define FASTIO_SMALL_STRING_HPP
+
+#include "format.hpp"
+#include "compile.hpp"
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace fastio {
+
+template<std::size_t N>
+class small_string;
+
+template<std::size_t N, typename... Args>
+constexpr small_string<N> format_fixed (compile_format_string fmt,
+                                        const Args&... args);
+
+template<std::size_t N, fixed_string Str, typename... Args>
+constexpr small_string<N> format_fixed (compiled_string<Str> fmt,
+                                        const Args&... args);
+
+/* String of at most N characters kept inline, NUL-terminated, with no
+   heap storage.  Produced by format_fixed, which formats straight into
+   it; output past N characters is dropped and reported by
+   truncated ().  format_fixed also runs in constant evaluation for
+   numbers, characters, booleans and strings, so a banner can be a
+   static constexpr small_string built at compile time.  */
+template<std::size_t N>
+class small_string
+{
+  static_assert (N > 0, "small_string needs room for at least one character");
+
+public:
+  /* Left uninitialized past the terminator at run time; a constant
+     must have every byte set.  */
+  constexpr small_string () noexcept
+  {
+    if (std::is_constant_evaluated ())
+      {
+        std::fill_n (m_data, N + 1, '\0');
+      }
+    m_data[0] = '\0';
+  }
+
+  static constexpr std::size_t capacity () noexcept { return N; }
+
+  constexpr std::size_t size () const noexcept { return m_size; }
+  constexpr bool empty () const noexcept { return m_size == 0; }
+  constexpr const char* data () const noexcept { return m_data; }
+  constexpr const char* c_str () const noexcept { return m_data; }
+  constexpr const char* begin () const noexcept { return m_data; }
+  constexpr const char* end () const noexcept { return m_data + m_size; }
+
+  /* Whether formatting produced more than N characters, and how many
+     it would have produced.  */
+  constexpr bool truncated () const noexcept { return m_full_size > m_size; }
+  constexpr std::size_t full_size () const noexcept { return m_full_size; }
+
+  constexpr std::string_view view () const noexcept
+  {
+    return std::string_view (m_data, m_size);
+  }
+
+  constexpr operator std::string_view () const noexcept { return view (); }
+
+  std::string str () const { return std::string (m_data, m_size); }
+
+  friend constexpr bool operator== (const small_string& lhs,
+                                    std::string_view rhs) noexcept
+  {
+    return lhs.view () == rhs;
+  }
+
+  friend std::ostream& operator<< (std::ostream& os, const small_string& str)
+  {
+    return os << str.view ();
+  }
+
+private:
+  template<std::size_t M, typename... Args>
+  friend constexpr small_string<M> format_fixed (compile_format_string,
+                                                 const Args&...);
+
+  template<std::size_t M, fixed_string Str, typename... Args>
+  friend constexpr small_string<M> format_fixed (compiled_string<Str>,
+                                                 const Args&...);
+
+  constexpr void finish (const fixed_buffer_context& ctx) noexcept
+  {
+    m_size = ctx.stored ();
+    m_full_size = ctx.size ();
+    m_data[m_size] = '\0';
+  }
+
+  char m_data[N + 1];
+  std::size_t m_size = 0;
+  std::size_t m_full_size = 0;
+};
+
+namespace internal
+{
+  inline constexpr std::size_t unbounded_size
+    = std::numeric_limits<std::size_t>::max ();
+
+  /* Upper bound on the length of a T formatted with SPEC, or
+     unbounded_size for strings and user types.  */
+  template<typename T>
+  constexpr std::size_t max_formatted_size (const format_spec& spec) noexcept
+  {
+    std::size_t body = unbounded_size;
+    if constexpr (std::is_same_v<T, bool>)
+      {
+        body = 5;
+      }
+    else if constexpr (std::integral<T>)
+      {
+        constexpr std::size_t bits = sizeof (T) * 8;
+        switch (spec.type)
+          {
+          case 'b': case 'B': body = bits + 1; break;
+          case 'o': body = (bits + 2) / 3 + 1; break;
+          case 'x': case 'X': body = bits / 4 + 1; break;
+          default: body = max_decimal_size<T>; break;
+          }
+        if (spec.alternate)
+          {
+            body += 2;
+          }
+      }
+    else if constexpr (std::floating_point<T>)
+      {
+        using limits = std::numeric_limits<T>;
+        std::size_t precision = spec.precision < 0 ? 0 : spec.precision;
+        if (spec.type == 'f' || spec.type == 'F')
+          {
+            body = limits::max_exponent10 - limits::min_exponent10
+                   + limits::max_digits10 + precision + 4;
+          }
+        else
+          {
+            body = std::max<std::size_t> (limits::max_digits10, precision) + 12;
+          }
+      }
+    return body == unbounded_size ? body
+                                  : std::max<std::size_t> (body, spec.width);
+  }
+
+  /* Upper bound on the output of compiled string COMPILED.  */
+  template<typename Compiled, typename... Args, std::size_t... I>
+  constexpr std::size_t max_compiled_size (std::index_sequence<I...>) noexcept
+  {
+    std::size_t total = Compiled::text_size;
+    for (std::size_t size : { std::size_t (0),
+                              max_formatted_size<Args> (Compiled::specs[I])... })
+      {
+        if (size == unbounded_size)
+          {
+            return unbounded_size;
+          }
+        total += size;
+      }
+    return total;
+  }
+}
+
+/* Format into a small_string<N> on the stack.  Output longer than N
+   characters is truncated, see small_string::truncated ().  */
+template<std::size_t N, typename... Args>
+constexpr small_string<N> format_fixed (compile_format_string fmt,
+                                        const Args&... args)
+{
+  small_string<N> result;
+  format_args<sizeof...(Args)> fargs (args...);
+  fixed_buffer_context ctx (result.m_data, N);
+
+  internal::vformat_to (ctx, fmt, fargs);
+  result.finish (ctx);
+  return result;
+}
+
+/* Same for a compiled format string.  When every argument has a
+   bounded length (numbers, characters, booleans), overflowing N is a
+   compile-time error.  */
+template<std::size_t N, fixed_string Str, typename... Args>
+constexpr small_string<N> format_fixed (compiled_string<Str> fmt,
+                                        const Args&... args)
+{
+  constexpr std::size_t bound = internal::max_compiled_size<compiled_string<Str>,
+                                                            Args...> (
+    std::index_sequence_for<Args...> {});
+  static_assert (bound == internal::unbounded_size || bound <= N,
+                 "small_string<N> is too small for this format string");
+
+  small_string<N> result;
+  fixed_buffer_context ctx (result.m_data, N);
+
+  internal::compiled_format_to (ctx, fmt, args...);
+  result.finish (ctx);
+  return result;
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_SMALL_STRING_HPP */
@@ -0,0 +1,220 @@
+/* stats.hpp - Opt-in hot-path counters for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_STATS_HPP
+#define FASTIO_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/* Counters are compiled in only when FASTIO_ENABLE_STATS is defined
+   (for the whole build, library included); otherwise every count_stat
+   call is empty and stats () reads all zeros.  */
+
+namespace fastio {
+
+enum class io_stat : unsigned char
+{
+  format_calls,          /* Format string expansions, including those of
+                            print_fmt and of format_to in formatters.  */
+  print_calls,           /* print* and println* calls.  */
+  bytes_formatted,       /* Output of format calls and of prints to
+                            buffered sinks.  */
+  estimate_misses,       /* format () results longer than the size
+                            estimate they were allocated with.  */
+  buffer_growths,        /* Reallocations of string and arena buffers.  */
+  stream_fallbacks,      /* Values formatted through std::ostringstream.  */
+  fd_writer_flushes,     /* write(2) calls by fd_writer.  */
+  gather_writer_flushes, /* writev(2) batches by gather_writer.  */
+  async_file_flushes     /* Buffers submitted by async_file_writer.  */
+};
+
+inline constexpr std::size_t stat_count = 9;
+
+inline constexpr std::array<std::string_view, stat_count> stat_names
+{
+  "format_calls", "print_calls", "bytes_formatted", "estimate_misses",
+  "buffer_growths", "stream_fallbacks", "fd_writer_flushes",
+  "gather_writer_flushes", "async_file_flushes"
+};
+
+/* Totals of every counter across all threads.  */
+struct io_stats
+{
+  std::array<std::uint64_t, stat_count> counts {};
+
+  std::uint64_t operator[] (io_stat s) const noexcept
+  {
+    return counts[static_cast<std::size_t> (s)];
+  }
+};
+
+namespace internal
+{
+  /* One thread's counters, written only by that thread.  */
+  struct stat_block
+  {
+    std::array<std::atomic<std::uint64_t>, stat_count> counts {};
+  };
+
+  /* Live blocks of running threads plus the totals of exited ones.  */
+  class stat_registry
+  {
+  public:
+    /* Never destroyed, so threads exiting after main still find it.  */
+    static stat_registry& instance ()
+    {
+      static stat_registry* registry = new stat_registry;
+      return *registry;
+    }
+
+    void attach (stat_block* block)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_live.push_back (block);
+    }
+
+    void detach (stat_block* block)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      for (std::size_t i = 0; i < stat_count; ++i)
+        {
+          m_retired.counts[i] += block->counts[i].load (std::memory_order_relaxed);
+        }
+      std::erase (m_live, block);
+    }
+
+    /* Counts made by a thread's exit-time destructors after its own
+       block was retired; shared, so they may be approximate.  */
+    stat_block* late () noexcept { return &m_late; }
+
+    io_stats collect ()
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      io_stats total = m_retired;
+      for (const stat_block* block : m_live)
+        {
+          for (std::size_t i = 0; i < stat_count; ++i)
+            {
+              total.counts[i] += block->counts[i].load (std::memory_order_relaxed);
+            }
+        }
+      for (std::size_t i = 0; i < stat_count; ++i)
+        {
+          total.counts[i] += m_late.counts[i].load (std::memory_order_relaxed);
+        }
+      return total;
+    }
+
+    void reset ()
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_retired = io_stats ();
+      for (auto& count : m_late.counts)
+        {
+          count.store (0, std::memory_order_relaxed);
+        }
+      for (stat_block* block : m_live)
+        {
+          for (auto& count : block->counts)
+            {
+              count.store (0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+  private:
+    std::mutex m_mutex;
+    std::vector<stat_block*> m_live;
+    io_stats m_retired;
+    stat_block m_late;
+  };
+
+  /* Registers the calling thread's block on construction and retires
+     it at thread exit.  CURRENT is what count_stat writes to; being a
+     constant-initialized pointer, reading it needs no TLS guard.  */
+  struct thread_stats
+  {
+    thread_stats ()
+    {
+      stat_registry::instance ().attach (&block);
+      current = &block;
+    }
+
+    ~thread_stats ()
+    {
+      stat_registry::instance ().detach (&block);
+      current = stat_registry::instance ().late ();
+    }
+
+    static inline thread_local stat_block* current = nullptr;
+
+    stat_block block;
+  };
+
+  inline stat_block* attach_thread_stats ()
+  {
+    thread_local thread_stats stats;
+    return thread_stats::current;
+  }
+
+  /* Add N to counter S of the calling thread: a plain load and store,
+     since no other thread writes it.  */
+  inline void count_stat ([[maybe_unused]] io_stat s,
+                          [[maybe_unused]] std::uint64_t n = 1)
+  {
+#ifdef FASTIO_ENABLE_STATS
+    stat_block* block = thread_stats::current;
+    if (block == nullptr) [[unlikely]]
+      {
+        block = attach_thread_stats ();
+      }
+    auto& count = block->counts[static_cast<std::size_t> (s)];
+    count.store (count.load (std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+#endif
+  }
+}
+
+/* Current totals.  Counts from other threads may lag by the updates
+   they are making at the moment of the call.  */
+inline io_stats stats ()
+{
+#ifdef FASTIO_ENABLE_STATS
+  return internal::stat_registry::instance ().collect ();
+#else
+  return io_stats ();
+#endif
+}
+
+/* Zero every counter.  Updates racing with the reset may survive it.  */
+inline void reset_stats ()
+{
+#ifdef FASTIO_ENABLE_STATS
+  internal::stat_registry::instance ().reset ();
+#endif
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_STATS_HPP */
@@ -0,0 +1,444 @@
+/* timing.hpp - Low-overhead timing and latency histograms for FastIO.
+   Copyright (C) 2025 deotermia
+
+   This file is part of FastIO, a fast I/O library for C++.
+
+   FastIO is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   FastIO is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef FASTIO_TIMING_HPP
+#define FASTIO_TIMING_HPP
+
+#include "format.hpp"
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <time.h>
+#include <vector>
+
+/* The time stamp counter is read directly on x86-64 when it runs at a
+   constant rate.  Define FASTIO_NO_TSC to always use
+   CLOCK_MONOTONIC_RAW.  */
+#if !defined(FASTIO_NO_TSC) && defined(__x86_64__) \
+    && (defined(__GNUC__) || defined(__clang__))
+#define FASTIO_X86_TSC 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace fastio {
+
+namespace internal
+{
+  inline std::uint64_t monotonic_raw_ns () noexcept
+  {
+    timespec ts;
+    clock_gettime (CLOCK_MONOTONIC_RAW, &ts);
+    return std::uint64_t (ts.tv_sec) * 1000000000u + ts.tv_nsec;
+  }
+
+  struct tsc_calibration
+  {
+    bool use_tsc;
+    double ns_per_tick;
+  };
+
+  /* Rate of the TSC against CLOCK_MONOTONIC_RAW, measured over 5 ms.
+     A TSC that is not invariant (changing with frequency scaling or
+     stopping in deep sleep) is not used.  */
+  inline tsc_calibration calibrate_tsc () noexcept
+  {
+#ifdef FASTIO_X86_TSC
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid (0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)))
+      {
+        std::uint64_t ns_start = monotonic_raw_ns ();
+        std::uint64_t tsc_start = __rdtsc ();
+        std::uint64_t ns_end;
+        do
+          {
+            ns_end = monotonic_raw_ns ();
+          }
+        while (ns_end - ns_start < 5000000);
+        std::uint64_t tsc_end = __rdtsc ();
+        if (tsc_end > tsc_start)
+          {
+            return { true, double (ns_end - ns_start) / double (tsc_end - tsc_start) };
+          }
+      }
+#endif
+    return { false, 1.0 };
+  }
+
+  /* Calibrated once per process, on first use.  */
+  inline const tsc_calibration& tsc () noexcept
+  {
+    static const tsc_calibration calibration = calibrate_tsc ();
+    return calibration;
+  }
+}
+
+/* Tick source for timing short operations: rdtsc (a few cycles, no
+   system call) when the TSC is invariant, CLOCK_MONOTONIC_RAW otherwise.
+   Ticks are only meaningful as differences; to_ns converts them.  */
+class cycle_clock
+{
+public:
+  static std::uint64_t ticks () noexcept
+  {
+#ifdef FASTIO_X86_TSC
+    if (internal::tsc ().use_tsc)
+      {
+        return __rdtsc ();
+      }
+#endif
+    return internal::monotonic_raw_ns ();
+  }
+
+  static bool uses_tsc () noexcept { return internal::tsc ().use_tsc; }
+
+  static double ns_per_tick () noexcept { return internal::tsc ().ns_per_tick; }
+
+  static std::uint64_t to_ns (std::uint64_t ticks) noexcept
+  {
+    return static_cast<std::uint64_t> (double (ticks) * ns_per_tick ());
+  }
+};
+
+/* stopwatch on cycle_clock, with laps for timing consecutive steps.  */
+class cycle_stopwatch
+{
+public:
+  cycle_stopwatch () noexcept : m_start (cycle_clock::ticks ()) {}
+
+  std::uint64_t elapsed_ticks () const noexcept
+  {
+    return cycle_clock::ticks () - m_start;
+  }
+
+  template<typename Duration = std::chrono::nanoseconds>
+  Duration elapsed () const noexcept
+  {
+    return std::chrono::duration_cast<Duration> (
+      std::chrono::nanoseconds (cycle_clock::to_ns (elapsed_ticks ())));
+  }
+
+  /* Nanoseconds since the last lap () or reset (), starting the next
+     lap.  */
+  std::uint64_t lap () noexcept
+  {
+    std::uint64_t now = cycle_clock::ticks ();
+    std::uint64_t ticks = now - m_start;
+    m_start = now;
+    return cycle_clock::to_ns (ticks);
+  }
+
+  void reset () noexcept { m_start = cycle_clock::ticks (); }
+
+private:
+  std::uint64_t m_start;
+};
+
+namespace internal
+{
+  /* HDR-style buckets: exact below 2^7, then 2^7 linear sub-buckets per
+     power of two, so every value is kept to within 1%.  */
+  inline constexpr unsigned histogram_sub_bits = 7;
+  inline constexpr std::size_t histogram_sub_count = std::size_t (1) << histogram_sub_bits;
+  inline constexpr std::size_t histogram_buckets
+    = (65 - histogram_sub_bits) << histogram_sub_bits;
+
+  constexpr std::size_t histogram_index (std::uint64_t value) noexcept
+  {
+    if (value < histogram_sub_count)
+      {
+        return value;
+      }
+    std::size_t octave = std::bit_width (value) - histogram_sub_bits;
+    return (octave << histogram_sub_bits) + (value >> (octave - 1))
+           - histogram_sub_count;
+  }
+
+  /* Largest value that lands in bucket INDEX.  */
+  constexpr std::uint64_t histogram_highest (std::size_t index) noexcept
+  {
+    if (index < histogram_sub_count)
+      {
+        return index;
+      }
+    std::size_t octave = index >> histogram_sub_bits;
+    std::uint64_t sub = (index & (histogram_sub_count - 1)) + histogram_sub_count;
+    return ((sub + 1) << (octave - 1)) - 1;
+  }
+}
+
+/* Distribution of latencies in nanoseconds, with percentiles accurate
+   to 1%.  Not thread-safe; latency_recorder collects from many threads
+   and hands out snapshots of this type.  Formats as a one-line summary:
+   fastio::println_fmt ("send: {}", histogram).  */
+class latency_histogram
+{
+public:
+  latency_histogram () : m_counts (internal::histogram_buckets) {}
+
+  void record (std::uint64_t ns) noexcept
+  {
+    ++m_counts[internal::histogram_index (ns)];
+    ++m_count;
+    m_sum += ns;
+    m_min = ns < m_min ? ns : m_min;
+    m_max = ns > m_max ? ns : m_max;
+  }
+
+  void merge (const latency_histogram& other) noexcept
+  {
+    for (std::size_t i = 0; i < m_counts.size (); ++i)
+      {
+        m_counts[i] += other.m_counts[i];
+      }
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = other.m_min < m_min ? other.m_min : m_min;
+    m_max = other.m_max > m_max ? other.m_max : m_max;
+  }
+
+  void reset () noexcept { *this = latency_histogram (); }
+
+  std::uint64_t count () const noexcept { return m_count; }
+  std::uint64_t min () const noexcept { return m_count ? m_min : 0; }
+  std::uint64_t max () const noexcept { return m_max; }
+
+  double mean () const noexcept
+  {
+    return m_count ? double (m_sum) / double (m_count) : 0.0;
+  }
+
+  /* Latency that Q percent of the samples do not exceed.  */
+  std::uint64_t percentile (double q) const noexcept
+  {
+    if (m_count == 0)
+      {
+        return 0;
+      }
+    double wanted = q / 100.0 * double (m_count);
+    std::uint64_t rank = wanted < 1.0 ? 1 : static_cast<std::uint64_t> (wanted);
+    rank += double (rank) < wanted;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < m_counts.size (); ++i)
+      {
+        seen += m_counts[i];
+        if (seen >= rank)
+          {
+            std::uint64_t value = internal::histogram_highest (i);
+            return value < m_min ? m_min : value > m_max ? m_max : value;
+          }
+      }
+    return m_max;
+  }
+
+private:
+  friend class latency_recorder;
+
+  std::vector<std::uint64_t> m_counts;
+  std::uint64_t m_count = 0;
+  std::uint64_t m_sum = 0;
+  std::uint64_t m_min = std::numeric_limits<std::uint64_t>::max ();
+  std::uint64_t m_max = 0;
+};
+
+template<>
+struct formatter<latency_histogram>
+{
+  void format (const latency_histogram& h, format_context& ctx) const
+  {
+    fastio::format_to (ctx, "count={} min={} p50={} p90={} p99={} p99.9={} "
+                            "p99.99={} max={} mean={:.1f} ns",
+                       h.count (), h.min (), h.percentile (50),
+                       h.percentile (90), h.percentile (99),
+                       h.percentile (99.9), h.percentile (99.99), h.max (),
+                       h.mean ());
+  }
+
+  std::size_t size_hint (const latency_histogram&) const { return 160; }
+};
+
+/* Latency histogram fed from any number of threads.  Each thread
+   records into its own shard with plain relaxed stores, so record ()
+   takes no lock and shares no cache line with other threads; only a
+   thread's first record () registers its shard.  snapshot () merges
+   the shards while recording goes on.  */
+class latency_recorder
+{
+public:
+  class timer;
+
+  latency_recorder () : m_id (next_id ()) {}
+
+  latency_recorder (const latency_recorder&) = delete;
+  latency_recorder& operator= (const latency_recorder&) = delete;
+
+  void record (std::uint64_t ns) { local ().record (ns); }
+
+  /* Record a cycle_clock interval.  */
+  void record_ticks (std::uint64_t ticks) { record (cycle_clock::to_ns (ticks)); }
+
+  /* Record the lifetime of the returned object.  */
+  timer time ();
+
+  latency_histogram snapshot () const
+  {
+    latency_histogram result;
+    std::lock_guard<std::mutex> lock (m_mutex);
+    for (const auto& s : m_shards)
+      {
+        for (std::size_t i = 0; i < internal::histogram_buckets; ++i)
+          {
+            result.m_counts[i] += s->counts[i].load (std::memory_order_relaxed);
+          }
+        result.m_count += s->count.load (std::memory_order_relaxed);
+        result.m_sum += s->sum.load (std::memory_order_relaxed);
+        std::uint64_t min = s->min.load (std::memory_order_relaxed);
+        std::uint64_t max = s->max.load (std::memory_order_relaxed);
+        result.m_min = min < result.m_min ? min : result.m_min;
+        result.m_max = max > result.m_max ? max : result.m_max;
+      }
+    return result;
+  }
+
+  /* Clear every shard.  Samples recorded at the same time may survive
+     the reset.  */
+  void reset () noexcept
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    for (const auto& s : m_shards)
+      {
+        for (auto& c : s->counts)
+          {
+            c.store (0, std::memory_order_relaxed);
+          }
+        s->count.store (0, std::memory_order_relaxed);
+        s->sum.store (0, std::memory_order_relaxed);
+        s->min.store (std::numeric_limits<std::uint64_t>::max (),
+                      std::memory_order_relaxed);
+        s->max.store (0, std::memory_order_relaxed);
+      }
+  }
+
+private:
+  /* Written only by its thread, so updates are a load and a store
+     rather than a locked read-modify-write.  */
+  struct alignas (64) shard
+  {
+    std::atomic<std::uint64_t> counts[internal::histogram_buckets] {};
+    std::atomic<std::uint64_t> count {};
+    std::atomic<std::uint64_t> sum {};
+    std::atomic<std::uint64_t> min { std::numeric_limits<std::uint64_t>::max () };
+    std::atomic<std::uint64_t> max {};
+
+    static void add (std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept
+    {
+      counter.store (counter.load (std::memory_order_relaxed) + n,
+                     std::memory_order_relaxed);
+    }
+
+    void record (std::uint64_t ns) noexcept
+    {
+      add (counts[internal::histogram_index (ns)], 1);
+      add (count, 1);
+      add (sum, ns);
+      if (ns < min.load (std::memory_order_relaxed))
+        {
+          min.store (ns, std::memory_order_relaxed);
+        }
+      if (ns > max.load (std::memory_order_relaxed))
+        {
+          max.store (ns, std::memory_order_relaxed);
+        }
+    }
+  };
+
+  /* Recorders are told apart by an id that is never reused, so a
+     thread's cached shard of a destroyed recorder is never matched.  */
+  static std::uint64_t next_id () noexcept
+  {
+    static std::atomic<std::uint64_t> id { 0 };
+    return id.fetch_add (1, std::memory_order_relaxed) + 1;
+  }
+
+  shard& local ()
+  {
+    struct entry
+    {
+      std::uint64_t id;
+      shard* s;
+    };
+    thread_local entry last { 0, nullptr };
+    if (last.id == m_id)
+      {
+        return *last.s;
+      }
+
+    thread_local std::vector<entry> entries;
+    for (const entry& e : entries)
+      {
+        if (e.id == m_id)
+          {
+            last = e;
+            return *e.s;
+          }
+      }
+
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_shards.push_back (std::make_unique<shard> ());
+    last = { m_id, m_shards.back ().get () };
+    entries.push_back (last);
+    return *last.s;
+  }
+
+  std::uint64_t m_id;
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<shard>> m_shards;
+};
+
+/* Records the time from construction to destruction.  */
+class latency_recorder::timer
+{
+public:
+  explicit timer (latency_recorder& recorder) noexcept
+    : m_recorder (recorder), m_start (cycle_clock::ticks ())
+  {
+  }
+
+  timer (const timer&) = delete;
+  timer& operator= (const timer&) = delete;
+
+  ~timer () { m_recorder.record_ticks (cycle_clock::ticks () - m_start); }
+
+private:
+  latency_recorder& m_recorder;
+  std::uint64_t m_start;
+};
+
+inline latency_recorder::timer latency_recorder::time ()
+{
+  return timer (*this);
+}
+
+} /* namespace fastio */
+
+#endif /* FASTIO_TIMING_HPP */
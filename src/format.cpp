@@ -43,5 +43,11 @@ template void vformat_to<4> (format_context&, std::string_view, const format_arg
 template void vformat_to<8> (format_context&, std::string_view, const format_args<8>&);
 template void vformat_to<16> (format_context&, std::string_view, const format_args<16>&);
 
+template void vformat_to<1> (format_context&, const compile_format_string&, const format_args<1>&);
+template void vformat_to<2> (format_context&, const compile_format_string&, const format_args<2>&);
+template void vformat_to<4> (format_context&, const compile_format_string&, const format_args<4>&);
+template void vformat_to<8> (format_context&, const compile_format_string&, const format_args<8>&);
+template void vformat_to<16> (format_context&, const compile_format_string&, const format_args<16>&);
+
 } /* namespace internal */
 } /* namespace fastio */
\ No newline at end of file
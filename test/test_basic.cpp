@@ -17,9 +17,69 @@
    along with FastIO.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "fastio/fastio.hpp"
-#include <cassert>
+#include <algorithm>
+#include <charconv>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <cstdio>
+#include <source_location>
 #include <sstream>
+#include <thread>
 #include <iostream>
+#include <unistd.h>
+#include <vector>
+
+/* assert () that stays active under NDEBUG, so Release builds run the
+   same checks.  */
+static void check(bool ok,
+                  std::source_location where = std::source_location::current()) {
+    if (!ok) {
+        std::fprintf(stderr, "%s:%u: check failed\n",
+                     where.file_name(), static_cast<unsigned>(where.line()));
+        std::abort();
+    }
+}
+
+/* Read back everything written to FILE from the start.  */
+static std::string read_back(std::FILE* file) {
+    std::string result;
+    char buffer[256];
+    ssize_t n;
+    ::lseek(fileno(file), 0, SEEK_SET);
+    while ((n = ::read(fileno(file), buffer, sizeof(buffer))) > 0) {
+        result.append(buffer, n);
+    }
+    return result;
+}
+
+/* Value whose stream output always fails.  */
+struct thrower {
+    friend std::ostream& operator<<(std::ostream&, const thrower&) {
+        throw std::runtime_error("thrower");
+    }
+};
+
+/* User type printed through fastio::formatter only, with no
+   operator<<.  */
+struct order {
+    int id;
+    double price;
+    int quantity;
+};
+
+template<>
+struct fastio::formatter<order> {
+    void format(const order& o, fastio::format_context& ctx) const {
+        ctx.append("order#");
+        ctx.append_decimal(o.id);
+        fastio::format_to(ctx, " {} @ {:.2f}", o.quantity, o.price);
+    }
+    
+    std::size_t size_hint(const order&) const { return 40; }
+};
 
 int main() {
     std::cout << "Running FastIO tests...\n";
@@ -30,7 +90,7 @@ int main() {
         fastio::fprintln(ss, "Hello, World!");
         std::string result = ss.str();
         std::cout << "Test 1: '" << result << "'\n";
-        assert(result == "Hello, World!\n");
+        check(result == "Hello, World!\n");
         std::cout << "✓ Test 1 passed\n";
     }
     
@@ -40,7 +100,7 @@ int main() {
         fastio::fprint(ss, 42, "test", 3.14);
         std::string result = ss.str();
         std::cout << "Test 2: '" << result << "'\n";
-        assert(result == "42test3.14");
+        check(result == "42test3.14");
         std::cout << "✓ Test 2 passed\n";
     }
     
@@ -50,7 +110,7 @@ int main() {
         fastio::fprint_spaced(ss, 42, "test", 3.14);
         std::string result = ss.str();
         std::cout << "Test 3: '" << result << "'\n";
-        assert(result == "42 test 3.14");
+        check(result == "42 test 3.14");
         std::cout << "✓ Test 3 passed\n";
     }
     
@@ -58,7 +118,7 @@ int main() {
     {
         auto result = fastio::format("{} + {} = {}", 2, 3, 5);
         std::cout << "Test 4: '" << result << "'\n";
-        assert(result == "2 + 3 = 5");
+        check(result == "2 + 3 = 5");
         std::cout << "✓ Test 4 passed\n";
     }
     
@@ -68,7 +128,7 @@ int main() {
         fastio::fprintln_fmt(ss, "{} + {} = {}", 2, 3, 5);
         std::string result = ss.str();
         std::cout << "Test 5: '" << result << "'\n";
-        assert(result == "2 + 3 = 5\n");
+        check(result == "2 + 3 = 5\n");
         std::cout << "✓ Test 5 passed\n";
     }
     
@@ -78,7 +138,7 @@ int main() {
         fastio::fprint_spaced(ss, true, false);
         std::string result = ss.str();
         std::cout << "Test 6: '" << result << "'\n";
-        assert(result == "true false");
+        check(result == "true false");
         std::cout << "✓ Test 6 passed\n";
     }
     
@@ -88,7 +148,7 @@ int main() {
         fastio::fprint_spaced(ss, 'A', 'B', 'C');
         std::string result = ss.str();
         std::cout << "Test 7: '" << result << "'\n";
-        assert(result == "A B C");
+        check(result == "A B C");
         std::cout << "✓ Test 7 passed\n";
     }
     
@@ -98,10 +158,758 @@ int main() {
         fastio::fprint(ss, true, false);
         std::string result = ss.str();
         std::cout << "Test 8: '" << result << "'\n";
-        assert(result == "truefalse");
+        check(result == "truefalse");
         std::cout << "✓ Test 8 passed\n";
     }
     
+    // Test 9: Mixed argument types in format
+    {
+        std::string name = "fastio";
+        long long big = -9000000000LL;
+        auto result = fastio::format("{} {} {} {} {} {}",
+                                     name, 'x', true, big, 7u, 2.5);
+        std::cout << "Test 9: '" << result << "'\n";
+        check(result == "fastio x true -9000000000 7 2.5");
+        std::cout << "✓ Test 9 passed\n";
+    }
+    
+    // Test 10: Compiled format string
+    {
+        auto result = fastio::format(fastio::compiled<"{{{}}} {} = {}">,
+                                     "x", 'y', 42);
+        std::cout << "Test 10: '" << result << "'\n";
+        check(result == "{x} y = 42");
+        std::cout << "✓ Test 10 passed\n";
+    }
+    
+    // Test 11: format_to / format_to_n
+    {
+        char buffer[32];
+        char* end = fastio::format_to(buffer, "{}-{}", 12, "ab");
+        check(std::string(buffer, end) == "12-ab");
+        
+        auto res = fastio::format_to_n(buffer, 4, "value={}", 123456);
+        check(res.size == 12 && res.out == buffer + 4);
+        check(std::string(buffer, res.out) == "valu");
+        
+        std::string out;
+        fastio::format_to(std::back_inserter(out),
+                          fastio::compiled<"[{}]">, 7);
+        std::cout << "Test 11: '" << out << "'\n";
+        check(out == "[7]");
+        std::cout << "✓ Test 11 passed\n";
+    }
+    
+    // Test 12: Exact formatted size
+    {
+        long long min = -9223372036854775807LL - 1;
+        check(fastio::formatted_size("{{{}}}", 1000) == 6);
+        check(fastio::formatted_size("{} {}", min, 2.5) == 24);
+        bool threw = false;
+        try {
+            fastio::formatted_size("{} {}", 1);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        check(threw);
+        auto result = fastio::format_exact("{} {}", min, 2.5);
+        std::cout << "Test 12: '" << result << "'\n";
+        check(result == "-9223372036854775808 2.5");
+        std::cout << "✓ Test 12 passed\n";
+    }
+    
+    // Test 13: Floating point
+    {
+        auto result = fastio::format("{} {} {} {}", 0.1, 1.0 / 3, 0.1f,
+                                     fastio::fixed(3.14159, 2));
+        std::cout << "Test 13: '" << result << "'\n";
+        check(result == "0.1 0.3333333333333333 0.1 3.14");
+        check(fastio::format("{}", fastio::scientific(1234.5, 2)) == "1.23e+03");
+        check(fastio::format("{}", fastio::fixed(1e300, 1)).size() == 303);
+        
+        std::stringstream ss;
+        fastio::fprint_spaced(ss, 2.5, fastio::general(1.0 / 3, 3));
+        check(ss.str() == "2.5 0.333");
+        std::cout << "✓ Test 13 passed\n";
+    }
+    
+    // Test 14: Format specifiers
+    {
+        auto result = fastio::format("{:>6}|{:<4}|{:*^7}|{:08x}|{:#b}|{:.3f}|{:+}",
+                                     42, "ab", 'c', 255, 5, 3.14159, 7);
+        std::cout << "Test 14: '" << result << "'\n";
+        check(result == "    42|ab  |***c***|000000ff|0b101|3.142|+7");
+        check(fastio::format(fastio::compiled<"{:>6}|{:#X}">, -3, 255)
+               == "    -3|0XFF");
+        check(fastio::formatted_size("{:>10}", 1) == 10);
+        static_assert([] {
+            fastio::format_spec spec;
+            return !fastio::parse_format_spec("1", spec)
+                   && !fastio::parse_format_spec("0:>4", spec)
+                   && fastio::parse_format_spec(":>4", spec) && spec.width == 4;
+        }(), "argument ids are rejected");
+        std::cout << "✓ Test 14 passed\n";
+    }
+    
+    // Test 15: Raw fd writer
+    {
+        std::FILE* file = std::tmpfile();
+        {
+            fastio::fd_writer out(fileno(file), fastio::flush_policy::manual, 16);
+            fastio::fprintln_spaced(out, "id", 42, 2.5);
+            fastio::fprintln_fmt(out, "{:>4}|{}", 7, std::string(40, 'x'));
+            check(out.buffered() > 0);
+            out.flush();
+            check(out.buffered() == 0);
+        }
+        std::string result = read_back(file);
+        std::cout << "Test 15: '" << result.substr(0, 10) << "...'\n";
+        check(result == "id 42 2.5\n   7|" + std::string(40, 'x') + "\n");
+        std::fclose(file);
+
+        // A record that fails to format leaves nothing behind, and a
+        // manual writer still flushes when destroyed.
+        file = std::tmpfile();
+        {
+            fastio::fd_writer out(fileno(file), fastio::flush_policy::manual, 16);
+            fastio::fprint(out, "kept ");
+            bool threw = false;
+            try {
+                fastio::fprintln_fmt(out, "a record of {}", thrower{});
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            check(threw);
+            fastio::fprintln(out, "after");
+        }
+        result = read_back(file);
+        check(result == "kept after\n");
+        std::fclose(file);
+        std::cout << "✓ Test 15 passed\n";
+    }
+    
+    // Test 16: fd scanner splits on any whitespace
+    {
+        std::FILE* file = std::tmpfile();
+        std::fputs("  -17\t+42\nhello_long_token 2.5e3\r\nx 1\nlast line\n", file);
+        std::fflush(file);
+        lseek(fileno(file), 0, SEEK_SET);
+        
+        fastio::fd_reader reader(fileno(file), 8);
+        int a = 0;
+        unsigned b = 0;
+        std::string word;
+        double d = 0;
+        char c = 0;
+        bool flag = false;
+        bool complete = fastio::finput(reader, a, b, word, d, c, flag);
+        std::string_view rest;
+        bool got_rest = reader.line(rest);
+        check(complete && got_rest && rest.empty());
+        std::string last;
+        if (reader.line(rest)) {
+            last = rest;
+        }
+        check(last == "last line");
+        std::cout << "Test 16: " << a << " " << b << " " << word << " "
+                  << d << " " << c << " " << flag << "\n";
+        check(a == -17 && b == 42 && word == "hello_long_token");
+        check(d == 2500.0 && c == 'x' && flag);
+        bool more = reader.read(a);
+        check(!more && reader.eof());
+        std::fclose(file);
+
+        // Other types still go through their operator>>.
+        file = std::tmpfile();
+        std::fputs("(1.5,-2) 7", file);
+        std::fflush(file);
+        lseek(fileno(file), 0, SEEK_SET);
+        fastio::fd_reader other(fileno(file));
+        std::complex<double> z;
+        bool read_other = fastio::finput(other, z, a);
+        check(read_other && z == std::complex<double>(1.5, -2) && a == 7);
+        std::fclose(file);
+        std::cout << "✓ Test 16 passed\n";
+    }
+    
+    // Test 17: Memory-mapped input and pipe fallback
+    {
+        std::FILE* file = std::tmpfile();
+        std::fputs("skip\n12 -3\tword\r\nlast", file);
+        std::fflush(file);
+        lseek(fileno(file), 5, SEEK_SET);
+        
+        fastio::mapped_file mapped(fileno(file));
+        check(mapped.mapped() && mapped.data().starts_with("12"));
+        std::vector<std::string_view> lines;
+        for (std::string_view line : fastio::lines(mapped)) {
+            lines.push_back(line);
+        }
+        std::cout << "Test 17: " << lines.size() << " lines\n";
+        check(lines.size() == 2 && lines[0] == "12 -3\tword" && lines[1] == "last");
+        check(fastio::parse_int<int>(lines[0].substr(3, 2)) == -3);
+        std::fclose(file);
+        
+        int fds[2];
+        int piped = pipe(fds);
+        check(piped == 0);
+        ssize_t written = write(fds[1], "7 8.5 x\n", 8);
+        check(written == 8);
+        close(fds[1]);
+        fastio::mapped_file stream(fds[0]);
+        int i = 0;
+        double d = 0;
+        std::string_view tail;
+        bool complete = fastio::finput(stream, i, d) && !stream.mapped();
+        for (std::string_view token : fastio::tokens(stream)) {
+            tail = token;
+        }
+        check(complete && i == 7 && d == 8.5 && tail == "x" && stream.eof());
+        close(fds[0]);
+        std::cout << "✓ Test 17 passed\n";
+    }
+    
+    // Test 18: Vector scanning kernels agree with the scalar ones
+    {
+        std::string text;
+        for (int i = 0; i < 300; ++i) {
+            text += (i % 37 == 0) ? '\n' : (i % 11 == 0) ? '\t' : (i % 7 == 0) ? ' ' : char('a' + i % 26);
+        }
+        const char* last = text.data() + text.size();
+        for (size_t i = 0; i < text.size(); ++i) {
+            const char* first = text.data() + i;
+            fastio::internal::space_index spaces;
+            check(spaces.find<true>(first, last)
+                   == fastio::internal::scalar::find_space(first, last));
+            check(spaces.find<false>(first, last)
+                   == fastio::internal::scalar::skip_space(first, last));
+            check(fastio::internal::find_newline(first, last)
+                   == fastio::internal::scalar::find_char(first, last, '\n'));
+        }
+        
+        std::vector<std::string_view> fields;
+        for (std::string_view field : fastio::split("a,,bc,", ',')) {
+            fields.push_back(field);
+        }
+        fastio::string_reader reader(" 5\t\v six ");
+        int five = 0;
+        std::string six;
+        bool complete = reader.read(five, six);
+        std::cout << "Test 18: " << fields.size() << " fields, " << five << " " << six << "\n";
+        check(fields.size() == 4 && fields[2] == "bc" && fields[3].empty());
+        check(complete && five == 5 && six == "six" && reader.token().empty());
+        std::cout << "✓ Test 18 passed\n";
+    }
+    
+    // Test 19: SWAR integer parsing
+    {
+        using fastio::try_parse_int;
+        check(try_parse_int<int>("-2147483648") == std::numeric_limits<int>::min());
+        check(try_parse_int<uint64_t>("18446744073709551615") == UINT64_MAX);
+        check(try_parse_int<uint64_t>("18446744073709551616").error()
+               == std::errc::result_out_of_range);
+        check(try_parse_int<long long>("0000000000000000000000012345678") == 12345678);
+        check(try_parse_int<int>("1234567890123").error() == std::errc::result_out_of_range);
+        check(try_parse_int<int>("12a").error() == std::errc::invalid_argument);
+        check(try_parse_int<unsigned>("-1").error() == std::errc::invalid_argument);
+        check(!try_parse_int<int>("") && !try_parse_int<int>("-") && !try_parse_int<int>("+5"));
+        check(!try_parse_int<int>("12 "));
+        
+        // parse_int keeps from_chars' prefix semantics
+        check(fastio::parse_int<int>("12 ") == 12);
+        check(fastio::parse_int<long long>("-42abc") == -42);
+        bool threw = false;
+        try {
+            fastio::parse_int<int>(" 1");
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        check(threw);
+        for (long long v : {0LL, 7LL, -99LL, 123456789LL, -9223372036854775807LL, 4242424242424242LL}) {
+            check(try_parse_int<long long>(std::to_string(v)) == v);
+        }
+        
+        int values[8] = {};
+        auto result = fastio::parse_ints<int>("1, 22,333\n-4444\t55555,\n", values);
+        auto bad = fastio::parse_ints<int>("1,,2", std::span<int>(values + 6, 2));
+        std::cout << "Test 19: parsed " << result.count << " values, last " << values[4] << "\n";
+        check(result.count == 5 && result.ec == std::errc() && values[3] == -4444);
+        check(bad.count == 1 && bad.ec == std::errc::invalid_argument);
+        std::cout << "✓ Test 19 passed\n";
+    }
+    
+    // Test 20: Digit-pair integer writer matches std::to_chars
+    {
+        char ours[32];
+        char reference[32];
+        auto matches_to_chars = [&](auto value) {
+            char* end = fastio::write_int(ours, value);
+            auto ref = std::to_chars(reference, reference + sizeof(reference), value);
+            check(std::string_view(ours, end) == std::string_view(reference, ref.ptr));
+        };
+        uint64_t power = 1;
+        for (int i = 0; i < 20; ++i, power *= 10) {
+            matches_to_chars(power - 1);
+            matches_to_chars(power);
+            matches_to_chars(power + 1);
+            matches_to_chars(static_cast<int64_t>(power) * -1);
+        }
+        for (int v = -100000; v <= 100000; v += 7) {
+            matches_to_chars(v);
+        }
+        matches_to_chars(std::numeric_limits<int>::min());
+        matches_to_chars(std::numeric_limits<long long>::min());
+        matches_to_chars(std::numeric_limits<unsigned long long>::max());
+        matches_to_chars(static_cast<signed char>(-128));
+        check(std::string_view(ours, fastio::write_int(ours, true)) == "1");
+        check(std::string_view(ours, fastio::write_int(ours, false)) == "0");
+        
+        std::string result = fastio::format("{} {} {:6d}", std::numeric_limits<int>::min(),
+                                            std::numeric_limits<long long>::min(), -42);
+        std::cout << "Test 20: " << result << "\n";
+        check(result == "-2147483648 -9223372036854775808    -42");
+        std::cout << "✓ Test 20 passed\n";
+    }
+    
+    // Test 21: Asynchronous logger from several threads
+    {
+        std::FILE* file = std::tmpfile();
+        constexpr int threads = 4;
+        constexpr int per_thread = 2000;
+        {
+            fastio::async_logger logger(fileno(file), fastio::overflow_policy::block, 64);
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&logger, t] {
+                    for (int i = 0; i < per_thread; ++i) {
+                        logger.log("worker {} item {:>4} {} {}", t, i,
+                                   std::string("tmp-") + std::to_string(i),
+                                   fastio::fixed(i * 0.5, 1));
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            logger.flush();
+            check(logger.dropped() == 0);
+        }
+        std::string result = read_back(file);
+        std::fclose(file);
+        size_t lines = 0;
+        std::vector<int> next(threads, 0);
+        for (std::string_view line : fastio::split(result, '\n')) {
+            if (line.empty()) {
+                continue;
+            }
+            fastio::string_reader reader(line);
+            std::string word, item, tmp, half;
+            int t = -1, i = -1;
+            reader.read(word, t, item, i, tmp, half);
+            bool in_order = t >= 0 && t < threads && i == next[t];
+            check(in_order);
+            if (in_order) {
+                ++next[t];
+            }
+            check(tmp == "tmp-" + std::to_string(i));
+            check(half == fastio::format("{:.1f}", i * 0.5));
+            ++lines;
+        }
+        
+        std::FILE* sink = std::tmpfile();
+        uint64_t dropped = 0;
+        {
+            fastio::async_logger logger(fileno(sink), fastio::overflow_policy::drop, 2);
+            for (int i = 0; i < 10000; ++i) {
+                logger.log("{}", i);
+            }
+            logger.flush();
+            dropped = logger.dropped();
+        }
+        size_t kept = 0;
+        std::string logged = read_back(sink);
+        for (std::string_view line : fastio::split(logged, '\n')) {
+            kept += !line.empty();
+        }
+        std::fclose(sink);
+
+        // Under grow, flush() also waits for the overflow queue to reach
+        // the file, and a record whose arguments fail to copy becomes an
+        // error line instead of stalling the consumer.
+        sink = std::tmpfile();
+        {
+            fastio::async_logger logger(fileno(sink), fastio::overflow_policy::grow, 2);
+            bool ring_bad = logger.log("bad {}", thrower{});
+            for (int i = 0; i < 5000; ++i) {
+                logger.log("{}", i);
+            }
+            bool overflow_bad = logger.log("bad {}", thrower{});
+            logger.log("good");
+            logger.flush();
+            std::string grown = read_back(sink);
+            check(!ring_bad && !overflow_bad);
+            check(std::count(grown.begin(), grown.end(), '\n') == 5003);
+            check(grown.starts_with("fastio: format error: thrower\n0\n"));
+            check(grown.ends_with("fastio: format error: thrower\ngood\n"));
+        }
+        std::fclose(sink);
+        std::cout << "Test 21: " << lines << " lines, " << dropped << " dropped\n";
+        check(lines == threads * per_thread);
+        check(kept + dropped == 10000);
+        std::cout << "✓ Test 21 passed\n";
+    }
+    
+    // Test 22: Whole-line per-thread writers never tear lines
+    {
+        std::FILE* file = std::tmpfile();
+        constexpr int threads = 4;
+        constexpr int per_thread = 3000;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([file, t] {
+                fastio::fd_writer writer(fileno(file), fastio::flush_policy::whole_lines, 256);
+                for (int i = 0; i < per_thread; ++i) {
+                    fastio::fprint(writer, "worker ", t, ' ');
+                    fastio::fprintln_fmt(writer, "item {} {}", i, std::string(i % 97, 'x'));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::string result = read_back(file);
+        std::fclose(file);
+        std::vector<int> next(threads, 0);
+        for (std::string_view line : fastio::split(result, '\n')) {
+            if (line.empty()) {
+                continue;
+            }
+            int t = 0;
+            int i = 0;
+            std::string_view tail;
+            fastio::string_reader reader(line);
+            std::string word;
+            std::string item;
+            reader.read(word, t, item, i);
+            reader.line(tail);
+            check(word == "worker" && item == "item");
+            check(t >= 0 && t < threads && i == next[t]);
+            ++next[t];
+            check(tail.find_first_not_of(' ') == tail.find('x'));
+            check(std::count(tail.begin(), tail.end(), 'x') == i % 97);
+        }
+        for (int t = 0; t < threads; ++t) {
+            check(next[t] == per_thread);
+        }
+        
+        std::FILE* sink = std::tmpfile();
+        {
+            fastio::fd_writer partial(fileno(sink), fastio::flush_policy::whole_lines, 8);
+            partial.write("ab\ncd");
+            partial.write("efgh");
+            check(partial.buffered() == 6);
+        }
+        check(read_back(sink) == "ab\ncdefgh");
+        std::fclose(sink);
+        std::cout << "✓ Test 22 passed\n";
+    }
+    
+    // Test 23: Gather writer references large strings until flush
+    {
+        std::FILE* file = std::tmpfile();
+        std::string storage(1000, 'p');
+        std::string_view payload(storage);
+        std::string expected;
+        {
+            fastio::gather_writer out(fileno(file), 512, 64);
+            for (int i = 0; i < 300; ++i) {
+                fastio::fprintln(out, "id=", i, ' ', payload);
+                fastio::fprintln_fmt(out, "{} short {}", i, std::string_view(payload).substr(0, 10));
+                expected += "id=" + std::to_string(i) + ' ' + storage + '\n';
+                expected += std::to_string(i) + " short pppppppppp\n";
+            }
+            check(out.segments() > 0);
+            
+            bool threw = false;
+            try {
+                fastio::fprintln(out, "lost ", payload, thrower{});
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            check(threw);
+            
+            // Owning strings are copied, so temporaries are safe
+            fastio::fprintln(out, std::string(300, 'x'));
+            fastio::fprintln_fmt(out, "{}", std::string(300, 'y'));
+            out.write(std::string(300, 'z'));
+            std::string owned(100, 'o');
+            out.write(owned);
+            owned.assign(100, '-');
+            expected += std::string(300, 'x') + '\n' + std::string(300, 'y') + '\n'
+                        + std::string(300, 'z') + std::string(100, 'o');
+            
+            std::string late(100, 'a');
+            out.write(std::string_view(late));
+            late.assign(100, 'b');
+            out.flush();
+            expected += std::string(100, 'b');
+        }
+        std::string result = read_back(file);
+        std::fclose(file);
+        check(result == expected);
+        std::cout << "✓ Test 23 passed\n";
+    }
+    
+    // Test 24: Asynchronous file writer, io_uring and worker thread
+    for (auto backend : {fastio::write_backend::automatic, fastio::write_backend::thread}) {
+        std::FILE* file = std::tmpfile();
+        std::string expected;
+        {
+            fastio::async_file_writer out(fileno(file), 4096, backend);
+            check(backend == fastio::write_backend::automatic
+                   || out.backend() == fastio::write_backend::thread);
+            for (int i = 0; i < 20000; ++i) {
+                fastio::fprintln_fmt(out, "line {} {:.2f}", i, i * 0.25);
+                expected += fastio::format("line {} {:.2f}\n", i, i * 0.25);
+            }
+            std::string big(10000, 'z');
+            fastio::fprint(out, big);
+            expected += big;
+            out.flush();
+        }
+        ssize_t written = ::write(fileno(file), "end\n", 4);
+        check(written == 4);
+        expected += "end\n";
+        std::string result = read_back(file);
+        std::fclose(file);
+        check(result == expected);
+    }
+    std::cout << "✓ Test 24 passed\n";
+    
+    // Test 25: Arena and pmr formatting
+    {
+        char storage[128];
+        fastio::format_arena arena(std::span<char>(storage), std::pmr::null_memory_resource());
+        std::string_view a = fastio::format(arena, "{}-{}", 1, "one");
+        std::string_view b = fastio::format(arena, fastio::compiled<"{:>5}">, 42);
+        check(a == "1-one" && b == "   42");
+        check(a.data() >= storage && b.data() == a.data() + a.size());
+        
+        fastio::format_arena heap(256);
+        std::vector<std::string_view> views;
+        std::string long_text(1000, 'L');
+        for (int i = 0; i < 50; ++i) {
+            views.push_back(fastio::format(heap, "field{} = {}", i, i % 7 ? "v" : long_text));
+        }
+        for (int i = 0; i < 50; ++i) {
+            check(views[i] == fastio::format("field{} = {}", i, i % 7 ? "v" : long_text));
+        }
+        heap.reset();
+        check(heap.used() == 0);
+        check(fastio::format(heap, "{}", 3.5) == "3.5");
+        
+        char pool[256];
+        std::pmr::monotonic_buffer_resource resource(pool, sizeof(pool), std::pmr::null_memory_resource());
+        std::pmr::string pmr = fastio::format(&resource, "pmr {} {}", 7, "x");
+        check(pmr == "pmr 7 x");
+        check(pmr.data() >= pool && pmr.data() < pool + sizeof(pool));
+        std::cout << "✓ Test 25 passed\n";
+    }
+    
+    // Test 26: Inline fixed-capacity format results
+    {
+        auto point = fastio::format_fixed<32>("x={} y={:.1f}", 12, 3.25);
+        check(point == "x=12 y=3.2" && !point.truncated());
+        check(std::string(point.c_str()) == "x=12 y=3.2");
+        
+        auto cut = fastio::format_fixed<8>("{} {}", "truncated", 123);
+        check(cut.view() == "truncate" && cut.truncated() && cut.full_size() == 13);
+        
+        auto pair = fastio::format_fixed<23>(fastio::compiled<"{}:{}">, INT32_MIN, INT32_MIN);
+        check(pair.view() == "-2147483648:-2147483648" && !pair.truncated());
+        auto hex = fastio::format_fixed<20>(fastio::compiled<"{:#x}">, UINT64_MAX);
+        check(hex == "0xffffffffffffffff");
+        auto name = fastio::format_fixed<4>(fastio::compiled<"{}">, std::string("abcdef"));
+        check(name == "abcd" && name.truncated());
+        std::cout << "✓ Test 26 passed\n";
+    }
+    
+    // Test 27: formatter<T> customization point
+    {
+        static_assert(fastio::has_formatter<order> && fastio::formattable<order>);
+        order o{7, 101.5, 300};
+        check(fastio::format("{}", o) == "order#7 300 @ 101.50");
+        check(fastio::format("[{:>22}]", o) == "[  order#7 300 @ 101.50]");
+        check(fastio::format("[{:*^23}|{:<5}]", o, o) == "[*order#7 300 @ 101.50**|order#7 300 @ 101.50]");
+        bool rejected = false;
+        try {
+            fastio::format("{:.1f}", std::vector<double>{1.5, 2.25});
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        check(rejected);
+        check(fastio::format(fastio::compiled<"{} {}">, o, 1) == "order#7 300 @ 101.50 1");
+        check(fastio::formatted_size("{}", o) == 20);
+        check(fastio::format_exact("{}!", o) == "order#7 300 @ 101.50!");
+        check(fastio::format_arg(o).estimated_size() == 40);
+        std::ostringstream oss;
+        fastio::fprintln(oss, o, ' ', 2);
+        fastio::fprint_fmt(oss, "{}", o);
+        check(oss.str() == "order#7 300 @ 101.50 2\norder#7 300 @ 101.50");
+        std::cout << "✓ Test 27 passed\n";
+    }
+    
+    // Test 28: Ranges, tuples and maps
+    {
+        std::vector<int> values{1, -2, 3};
+        std::vector<double> reals{0.5, 2.0};
+        std::vector<std::vector<int>> nested{{1, 2}, {}, {3}};
+        std::map<std::string, int> counts{{"a", 1}, {"b", 2}};
+        std::pair<int, std::string> pair{4, "four"};
+        std::tuple<int, char, double> tuple{1, 'x', 1.5};
+        check(fastio::format("{}", values) == "[1, -2, 3]");
+        check(fastio::format("{}", std::span<const double>(reals)) == "[0.5, 2]");
+        check(fastio::format("{}", std::vector<int>{}) == "[]");
+        check(fastio::format("{}", nested) == "[[1, 2], [], [3]]");
+        check(fastio::format("{}", counts) == "{a: 1, b: 2}");
+        check(fastio::format("{} {}", pair, tuple) == "(4, four) (1, x, 1.5)");
+        check(fastio::format("<{}>", fastio::join(values, " | ")) == "<1 | -2 | 3>");
+        check(fastio::format("{:>12}", values) == "  [1, -2, 3]");
+        check(fastio::format(fastio::compiled<"{}">, counts) == "{a: 1, b: 2}");
+        check(fastio::format_arg(values).estimated_size() >= fastio::formatted_size("{}", values));
+        std::ostringstream oss;
+        fastio::fprintln(oss, values, ' ', pair);
+        check(oss.str() == "[1, -2, 3] (4, four)\n");
+        std::cout << "✓ Test 28 passed\n";
+    }
+
+    // Test 29: Cycle clock and latency histograms
+    {
+        fastio::cycle_stopwatch sw;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto ms = sw.elapsed<std::chrono::milliseconds>().count();
+        check(ms >= 15 && ms < 2000);
+
+        fastio::latency_histogram h;
+        check(h.percentile(50) == 0 && fastio::format("{}", h).starts_with("count=0 "));
+        for (std::uint64_t ns = 1; ns <= 100000; ++ns) {
+            h.record(ns);
+        }
+        check(h.count() == 100000 && h.min() == 1 && h.max() == 100000);
+        auto near = [](std::uint64_t value, std::uint64_t exact) {
+            return value >= exact && value <= exact + exact / 100;
+        };
+        check(near(h.percentile(50), 50000) && near(h.percentile(99), 99000));
+        check(h.percentile(100) == 100000 && h.percentile(0) == 1);
+        for (std::uint64_t ns : {0ull, 127ull, 128ull, 1000003ull, ~0ull}) {
+            std::size_t index = fastio::internal::histogram_index(ns);
+            check(index < fastio::internal::histogram_buckets);
+            check(fastio::internal::histogram_highest(index) >= ns);
+            check(index == 0 || fastio::internal::histogram_highest(index - 1) < ns);
+        }
+
+        fastio::latency_recorder recorder;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&recorder, t] {
+                for (int i = 0; i < 10000; ++i) {
+                    recorder.record(20 * (t + 1));
+                }
+                auto timer = recorder.time();
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        fastio::latency_histogram all = recorder.snapshot();
+        check(all.count() == 40004 && all.percentile(10) == 20);
+        check(all.percentile(99) == 80);
+        recorder.reset();
+        check(recorder.snapshot().count() == 0);
+        std::cout << "✓ Test 29 passed\n";
+    }
+
+    // Test 30: Hot-path counters (all zero unless FASTIO_ENABLE_STATS)
+    {
+        fastio::reset_stats();
+        std::string grown = fastio::format("{}", std::string(1000, 'x'));
+        char buffer[64];
+        fastio::format_to(buffer, fastio::compiled<"{}-{}">, 12, 34);
+        fastio::format("{}", std::vector<int>{1, 2});
+        std::thread([] { fastio::format("{}", 5); }).join();
+        std::ostringstream oss;
+        fastio::fprintln(oss, 1, 2);
+        {
+            FILE* tmp = std::tmpfile();
+            fastio::fd_writer out(fileno(tmp));
+            fastio::fprintln(out, "abc");
+            out.flush();
+            std::fclose(tmp);
+        }
+        fastio::io_stats totals = fastio::stats();
+#ifdef FASTIO_ENABLE_STATS
+        check(totals[fastio::io_stat::format_calls] == 4);
+        check(totals[fastio::io_stat::print_calls] == 2);
+        check(totals[fastio::io_stat::bytes_formatted] == 1000 + 5 + 6 + 1 + 4);
+        check(totals[fastio::io_stat::fd_writer_flushes] == 1);
+        check(totals[fastio::io_stat::stream_fallbacks] == 0);
+        fastio::reset_stats();
+        check(fastio::stats()[fastio::io_stat::format_calls] == 0);
+#else
+        for (std::uint64_t count : totals.counts) {
+            check(count == 0);
+        }
+#endif
+        std::ostringstream dump;
+        fastio::dump_stats(dump);
+        check(dump.str().starts_with("format_calls "));
+        std::cout << "✓ Test 30 passed\n";
+    }
+
+    // Test 31: Formatting in constant evaluation
+    {
+        static constexpr auto banner = fastio::format_fixed<48>(
+            "fastio {}.{}.{} [{:>4}] {:#x} {} {:+}", 1, 2, 3, "ok", 255, true, -7);
+        static_assert(banner == "fastio 1.2.3 [  ok] 0xff true -7");
+        static constexpr auto version = fastio::format_fixed<32>(fastio::compiled<"v{}.{:02}">, 4, 5);
+        static_assert(version.view() == "v4.05");
+        static_assert(fastio::formatted_size("{}-{:X}", -12345, 48879u) == 11);
+        constexpr auto truncated = fastio::format_fixed<4>("{}", 123456);
+        static_assert(truncated.truncated() && truncated == "1234");
+        constexpr auto bits = [] {
+            std::array<char, 16> out{};
+            fastio::format_to(out.data(), "{:08b}{}", 5, 'c');
+            return out;
+        }();
+        static_assert(std::string_view(bits.data()) == "00000101c");
+        check(std::string(banner.c_str()) == "fastio 1.2.3 [  ok] 0xff true -7");
+        std::cout << "✓ Test 31 passed\n";
+    }
+
+    // Test 32: Hex dumps, whole and cut at window edges
+    {
+        std::vector<std::byte> bytes(300);
+        for (std::size_t i = 0; i < bytes.size(); ++i) {
+            bytes[i] = std::byte((i * 37 + 11) & 0xff);
+        }
+        std::string expected;
+        for (std::byte b : bytes) {
+            expected += fastio::format("{:02x}", unsigned(b));
+        }
+        for (std::size_t n : {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 300}) {
+            auto span = std::span<const std::byte>(bytes).first(n);
+            check(fastio::format("{}", fastio::hex_dump(span)) == expected.substr(0, 2 * n));
+        }
+        std::string upper = fastio::format("<{}>", fastio::hex_dump(std::span(bytes).first(40), true));
+        check(upper.size() == 82 && upper[1] == '0' && upper[2] == 'B'
+               && upper.find_first_of("abcdef") == std::string::npos);
+        auto cut = fastio::format_fixed<33>("x{}", fastio::hex_dump(bytes));
+        check(cut.truncated() && cut.view() == "x" + expected.substr(0, 32));
+        check(fastio::formatted_size("{}", fastio::hex_dump(bytes)) == 600);
+        check(fastio::format("{:x} {:X} {:#b} {:o}", 48879, 48879, 5, 8) == "beef BEEF 0b101 10");
+        std::cout << "✓ Test 32 passed\n";
+    }
+
     std::cout << "\n✅ All tests passed!\n";
     return 0;
 }
\ No newline at end of file